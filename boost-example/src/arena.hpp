@@ -0,0 +1,266 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Bump allocator for everything that lives exactly as long as one request.
+// Deallocation is a no-op; reset() rewinds to the first block and keeps up to
+// kRetainBytes of the blocks it grew, so once a connection has seen its usual
+// request sizes, later requests allocate nothing from the heap.
+class Arena {
+  public:
+    static constexpr size_t kBlockSize = 4096;
+    static constexpr size_t kRetainBytes = 64 * 1024;
+
+    Arena() = default;
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    ~Arena() { freeAfter(nullptr); }
+
+    void *allocate(size_t bytes, size_t align) {
+        for (;;) {
+            if (current_ != nullptr) {
+                char *p = alignUp(ptr_, align);
+                if (p + bytes <= current_->end()) {
+                    ptr_ = p + bytes;
+                    return p;
+                }
+                // Move on to the next retained block if it is big enough.
+                Block *next = current_->next;
+                if (next != nullptr && bytes + align <= next->size) {
+                    use(next);
+                    continue;
+                }
+            }
+            grow(bytes + align);
+        }
+    }
+
+    // Invalidates everything allocated since the last reset.
+    void reset() {
+        Block *keep = nullptr;
+        size_t kept = 0;
+        for (Block *b = head_; b != nullptr && kept + b->size <= kRetainBytes; b = b->next) {
+            keep = b;
+            kept += b->size;
+        }
+        freeAfter(keep);
+        if (keep != nullptr) {
+            keep->next = nullptr;
+            use(head_);
+        }
+    }
+
+  private:
+    struct Block {
+        Block *next;
+        size_t size;  // usable bytes after the header
+        char *begin() { return reinterpret_cast<char *>(this + 1); }
+        char *end() { return begin() + size; }
+    };
+
+    static char *alignUp(char *p, size_t align) {
+        auto v = reinterpret_cast<uintptr_t>(p);
+        return reinterpret_cast<char *>((v + align - 1) & ~(uintptr_t(align) - 1));
+    }
+
+    void use(Block *b) {
+        current_ = b;
+        ptr_ = b->begin();
+    }
+
+    // Links a new block right after the current one.
+    void grow(size_t bytes) {
+        size_t size = std::max(kBlockSize, bytes);
+        auto *b = static_cast<Block *>(::operator new(sizeof(Block) + size));
+        b->size = size;
+        if (current_ == nullptr) {
+            b->next = head_;
+            head_ = b;
+        } else {
+            b->next = current_->next;
+            current_->next = b;
+        }
+        use(b);
+    }
+
+    // Frees the blocks after `b`, or all blocks when b is null.
+    void freeAfter(Block *b) {
+        Block *next = b != nullptr ? b->next : head_;
+        while (next != nullptr) {
+            Block *dead = next;
+            next = next->next;
+            ::operator delete(dead);
+        }
+        if (b == nullptr)
+            head_ = current_ = nullptr;
+    }
+
+    Block *head_ = nullptr;
+    Block *current_ = nullptr;
+    char *ptr_ = nullptr;
+};
+
+// Standard allocator over an Arena, for Beast's basic_fields and
+// basic_string_body. A default-constructed one uses the heap, so messages
+// that are not tied to a session (tests, cached responses) still work.
+template <typename T>
+class ArenaAllocator {
+  public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    ArenaAllocator() noexcept = default;
+    explicit ArenaAllocator(Arena &arena) noexcept : arena_(&arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U> &other) noexcept : arena_(other.arena()) {}
+
+    T *allocate(size_t n) {
+        if (arena_ == nullptr)
+            return static_cast<T *>(::operator new(n * sizeof(T)));
+        return static_cast<T *>(arena_->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T *p, size_t) noexcept {
+        if (arena_ == nullptr)
+            ::operator delete(p);
+    }
+
+    Arena *arena() const noexcept { return arena_; }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U> &other) const noexcept {
+        return arena_ == other.arena();
+    }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U> &other) const noexcept {
+        return arena_ != other.arena();
+    }
+
+  private:
+    Arena *arena_ = nullptr;
+};
+
+// Allocator for asynchronous operation state (Beast keeps its serializer and
+// parser there). Freed blocks go to a small per-thread cache by size class
+// instead of back to the heap; a block may be freed on another thread than
+// the one that allocated it.
+template <typename T>
+class RecyclingAllocator {
+  public:
+    using value_type = T;
+
+    RecyclingAllocator() noexcept = default;
+    template <typename U>
+    RecyclingAllocator(const RecyclingAllocator<U> &) noexcept {}
+
+    T *allocate(size_t n) { return static_cast<T *>(cache().take(n * sizeof(T))); }
+    void deallocate(T *p, size_t n) noexcept { cache().give(p, n * sizeof(T)); }
+
+    template <typename U>
+    bool operator==(const RecyclingAllocator<U> &) const noexcept {
+        return true;
+    }
+    template <typename U>
+    bool operator!=(const RecyclingAllocator<U> &) const noexcept {
+        return false;
+    }
+
+  private:
+    // Power-of-two classes from 64 bytes to 8 KiB; larger sizes bypass it.
+    class Cache {
+        static constexpr size_t kClasses = 8;
+        static constexpr size_t kPerClass = 16;
+
+        struct Node {
+            Node *next;
+        };
+
+      public:
+        ~Cache() {
+            for (auto &c : lists_) {
+                while (c.head != nullptr) {
+                    Node *dead = c.head;
+                    c.head = dead->next;
+                    ::operator delete(dead);
+                }
+            }
+        }
+
+        void *take(size_t bytes) {
+            size_t c = classOf(bytes);
+            if (c == kClasses)
+                return ::operator new(bytes);
+            List &list = lists_[c];
+            if (list.head == nullptr)
+                return ::operator new(size_t(64) << c);
+            Node *n = list.head;
+            list.head = n->next;
+            --list.count;
+            return n;
+        }
+
+        void give(void *p, size_t bytes) {
+            size_t c = classOf(bytes);
+            if (c == kClasses || lists_[c].count == kPerClass)
+                return ::operator delete(p);
+            auto *n = static_cast<Node *>(p);
+            n->next = lists_[c].head;
+            lists_[c].head = n;
+            ++lists_[c].count;
+        }
+
+      private:
+        struct List {
+            Node *head = nullptr;
+            size_t count = 0;
+        };
+
+        static size_t classOf(size_t bytes) {
+            size_t c = 0;
+            while (c < kClasses && (size_t(64) << c) < bytes) {
+                ++c;
+            }
+            return c;
+        }
+
+        List lists_[kClasses];
+    };
+
+    static Cache &cache() {
+        static thread_local Cache cache;
+        return cache;
+    }
+};
+
+// Wraps a completion handler so that Asio and Beast allocate the
+// operation's state through RecyclingAllocator.
+template <typename Handler>
+class Recycled {
+  public:
+    using allocator_type = RecyclingAllocator<void>;
+
+    explicit Recycled(Handler handler) : handler_(std::move(handler)) {}
+
+    allocator_type get_allocator() const noexcept { return {}; }
+
+    template <typename... Args>
+    void operator()(Args &&...args) {
+        handler_(std::forward<Args>(args)...);
+    }
+
+  private:
+    Handler handler_;
+};
+
+template <typename Handler>
+Recycled<std::decay_t<Handler>> recycled(Handler &&handler) {
+    return Recycled<std::decay_t<Handler>>(std::forward<Handler>(handler));
+}
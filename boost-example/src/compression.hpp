@@ -0,0 +1,192 @@
+#pragma once
+
+#include <boost/beast/core/string.hpp>
+#include <boost/beast/http/field.hpp>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <zlib.h>
+
+// Content codings the server can produce, in order of preference.
+enum class Encoding {
+    Identity,
+    Gzip,
+    Deflate,  // zlib format (RFC 1950), which is what HTTP calls "deflate"
+};
+
+constexpr size_t kEncodings = 3;
+
+inline const char *toString(Encoding encoding) {
+    switch (encoding) {
+    case Encoding::Gzip:
+        return "gzip";
+    case Encoding::Deflate:
+        return "deflate";
+    default:
+        return "identity";
+    }
+}
+
+// Picks the coding for an Accept-Encoding header value: gzip if acceptable,
+// then deflate, else identity. Tokens with q=0 are refused; "*" stands for
+// any coding not listed. Parses in place, without allocating.
+inline Encoding negotiate(boost::beast::string_view accept_encoding) {
+    using string_view = boost::beast::string_view;
+
+    auto trim = [](string_view s) {
+        while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+            s.remove_prefix(1);
+        while (!s.empty() && (s.back() == ' ' || s.back() == '\t'))
+            s.remove_suffix(1);
+        return s;
+    };
+    auto iequals = [](string_view a, string_view b) {
+        if (a.size() != b.size())
+            return false;
+        for (size_t i = 0; i < a.size(); ++i) {
+            if ((a[i] | 0x20) != (b[i] | 0x20))
+                return false;
+        }
+        return true;
+    };
+
+    // -1: not mentioned, 0: refused, 1: acceptable
+    int gzip = -1, deflate = -1, any = -1;
+    while (!accept_encoding.empty()) {
+        size_t comma = accept_encoding.find(',');
+        string_view item = accept_encoding.substr(0, comma);
+        accept_encoding.remove_prefix(comma == string_view::npos ? accept_encoding.size()
+                                                                 : comma + 1);
+
+        size_t semi = item.find(';');
+        string_view coding = trim(item.substr(0, semi));
+        int accepted = 1;
+        if (semi != string_view::npos) {
+            string_view param = trim(item.substr(semi + 1));
+            if (param.size() > 2 && (param[0] | 0x20) == 'q' && param[1] == '=') {
+                // q=0, q=0.0, q=0.000 all refuse; anything else accepts.
+                accepted = 0;
+                for (char c : param.substr(2)) {
+                    if (c >= '1' && c <= '9')
+                        accepted = 1;
+                }
+            }
+        }
+
+        if (iequals(coding, "gzip") || iequals(coding, "x-gzip"))
+            gzip = accepted;
+        else if (iequals(coding, "deflate"))
+            deflate = accepted;
+        else if (coding == "*")
+            any = accepted;
+    }
+
+    if (gzip == 1 || (gzip == -1 && any == 1))
+        return Encoding::Gzip;
+    if (deflate == 1 || (deflate == -1 && any == 1))
+        return Encoding::Deflate;
+    return Encoding::Identity;
+}
+
+// True for media types that are worth compressing (text, JSON, XML, JS).
+inline bool compressible(boost::beast::string_view content_type) {
+    return content_type.starts_with("text/") ||
+           content_type.find("json") != boost::beast::string_view::npos ||
+           content_type.find("xml") != boost::beast::string_view::npos ||
+           content_type.find("javascript") != boost::beast::string_view::npos;
+}
+
+struct CompressionOptions {
+    bool enabled = true;
+    size_t min_size = 1024;  // smaller bodies are sent as they are
+    int level = 6;           // for bodies built per request
+    int static_level = 9;    // for cached bodies, compressed only once
+};
+
+// True if the response should be offered compressed: large enough, of a
+// compressible type, and not already encoded.
+template <typename Message>
+bool worthCompressing(const Message &res, const CompressionOptions &options) {
+    return options.enabled && res.body().size() >= options.min_size &&
+           res.find(boost::beast::http::field::content_encoding) == res.end() &&
+           compressible(res[boost::beast::http::field::content_type]);
+}
+
+// Adds Accept-Encoding to Vary: caches must key on it once the body can vary.
+template <typename Message>
+void varyOnEncoding(Message &res) {
+    auto vary = res[boost::beast::http::field::vary];
+    if (vary.empty()) {
+        res.set(boost::beast::http::field::vary, "Accept-Encoding");
+    } else if (vary.find("Accept-Encoding") == boost::beast::string_view::npos) {
+        std::string value(vary.data(), vary.size());
+        res.set(boost::beast::http::field::vary, value + ", Accept-Encoding");
+    }
+}
+
+// One deflate stream per coding, initialized on first use and then only
+// reset between bodies. Not thread-safe: use forThread().
+class Deflater {
+  public:
+    Deflater() = default;
+    Deflater(const Deflater &) = delete;
+    Deflater &operator=(const Deflater &) = delete;
+
+    ~Deflater() {
+        for (auto &s : streams_) {
+            if (s.ready)
+                deflateEnd(&s.z);
+        }
+    }
+
+    static Deflater &forThread() {
+        static thread_local Deflater deflater;
+        return deflater;
+    }
+
+    // Compresses `in` into `out` (any std::basic_string<char, ...>), which is
+    // resized to exactly the compressed size. One pass, straight into the
+    // output's storage. Throws std::runtime_error if zlib fails.
+    template <typename String>
+    void compress(const char *in, size_t size, Encoding encoding, int level, String &out) {
+        z_stream &z = stream(encoding, level);
+        out.resize(deflateBound(&z, size));
+        z.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(in));
+        z.avail_in = static_cast<uInt>(size);
+        z.next_out = reinterpret_cast<Bytef *>(&out[0]);
+        z.avail_out = static_cast<uInt>(out.size());
+        int ret = deflate(&z, Z_FINISH);
+        if (ret != Z_STREAM_END)
+            throw std::runtime_error("deflate failed: " + std::to_string(ret));
+        out.resize(z.total_out);
+    }
+
+  private:
+    struct Stream {
+        z_stream z{};
+        bool ready = false;
+        int level = 0;
+    };
+
+    z_stream &stream(Encoding encoding, int level) {
+        Stream &s = streams_[static_cast<size_t>(encoding)];
+        if (s.ready) {
+            deflateReset(&s.z);
+            // With nothing buffered after the reset this only swaps the settings.
+            if (s.level != level) {
+                deflateParams(&s.z, level, Z_DEFAULT_STRATEGY);
+                s.level = level;
+            }
+            return s.z;
+        }
+        // gzip is zlib's format with 16 added to windowBits.
+        int window_bits = encoding == Encoding::Gzip ? MAX_WBITS + 16 : MAX_WBITS;
+        if (deflateInit2(&s.z, level, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+            throw std::runtime_error("deflateInit2 failed");
+        s.ready = true;
+        s.level = level;
+        return s.z;
+    }
+
+    Stream streams_[kEncodings];
+};
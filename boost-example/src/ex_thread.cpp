@@ -1,6 +1,9 @@
 #include <boost/thread.hpp>
 #include <iostream>
-#include <map>
+#include <memory>
+#include <string>
+
+#include "concurrent_registry.hpp"
 
 class ThreadManager {
   public:
@@ -11,33 +14,42 @@ class ThreadManager {
     } thread_info;
     ThreadManager() {}
 
-    void registerThread(std::string name, boost::thread &thread) {
-        thread_info info;
-        info.thread_name = name;
-        info.thread = std::move(thread);
-        info.stop_flag = false;
-        m_mThreads[name] = std::move(info);
+    bool registerThread(std::string name, boost::thread &thread) {
+        auto info = std::make_shared<thread_info>();
+        info->thread_name = name;
+        info->thread = std::move(thread);
+        info->stop_flag = false;
+        return m_mThreads.insert(name, std::move(info));
     }
 
     void stop(std::string th_name) {
-        // m_mThreads[th_name].thread.interrupt();
-        m_mThreads[th_name].thread.join();
+        auto info = m_mThreads.find(th_name);
+        if (!info) {
+            std::cout << "Unknown thread: " << th_name << "\n";
+            return;
+        }
+        // info->thread.interrupt();
+        info->thread.join();
     }
 
     void stop_timed(std::string th_name, int timeout) {
-        // m_mThreads[th_name].thread.interrupt();
-        if (!m_mThreads[th_name].thread.timed_join(
-                boost::posix_time::seconds(timeout))) {
+        auto info = m_mThreads.find(th_name);
+        if (!info) {
+            std::cout << "Unknown thread: " << th_name << "\n";
+            return;
+        }
+        // info->thread.interrupt();
+        if (!info->thread.timed_join(boost::posix_time::seconds(timeout))) {
             std::cout << "Thread stop timed out, stopping the thread\n";
-            m_mThreads[th_name].thread.interrupt();
-            m_mThreads[th_name].thread.join();
+            info->thread.interrupt();
+            info->thread.join();
         } else {
             std::cout << "Operation completed within timeout\n";
         }
     }
 
   private:
-    std::map<std::string, thread_info> m_mThreads;
+    ConcurrentRegistry<thread_info> m_mThreads;
 };
 
 void threadFunction() {
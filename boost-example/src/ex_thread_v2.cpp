@@ -1,129 +1,361 @@
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
 #include <future>
 #include <iostream>
-#include <map>
+#include <memory>
+#include <mutex>
 #include <thread>
 #include <optional>
+#include <stop_token>
 
-typedef struct ThreadInfo {
+#include "concurrent_registry.hpp"
+#include "job_metrics.hpp"
+
+enum class TaskStatus { NotRunning, Running, Done, Error, TimedOut };
+
+const char *toString(TaskStatus status) {
+    switch (status) {
+    case TaskStatus::NotRunning: return "Not Running";
+    case TaskStatus::Running: return "Running";
+    case TaskStatus::Done: return "Done";
+    case TaskStatus::Error: return "Error";
+    case TaskStatus::TimedOut: return "Timed Out";
+    }
+    return "Unknown";
+}
+
+template <typename R>
+struct ThreadInfo {
     std::string t_name;
-    std::future<bool> future;
-    bool status;
-    bool stop_flag;
-    std::string result;
-    std::string error;
-} ThreadInfo;
+    // Stop requests go through this source rather than the jthread's own:
+    // it exists before the entry is published, while `thread` is assigned
+    // afterwards and is only touched by registerThread and ~ThreadMgt.
+    std::stop_source stop;
+    std::jthread thread;
+    std::atomic<TaskStatus> status{TaskStatus::NotRunning};
+    std::optional<R> result;           // set when status is Done
+    std::exception_ptr error;          // set when status is Error
+    std::atomic<bool> finished{false};
+    std::atomic<bool> collected{false};
+    ThreadInfo *next_completed = nullptr;  // intrusive completion-queue link
+    // Per-task metrics: wakeup is registration to first instruction of the
+    // task, run is the task body; a join that times out counts as an overrun.
+    JobMetrics metrics;
+};
+
+// Lock-free multi-producer completion queue. Finishing tasks push their own
+// ThreadInfo (no allocation); consumers take everything at once with a
+// single exchange and get it back in completion order.
+template <typename R>
+class CompletionQueue {
+  public:
+    void push(ThreadInfo<R> *info) {
+        ThreadInfo<R> *head = m_head.load(std::memory_order_relaxed);
+        do {
+            info->next_completed = head;
+        } while (!m_head.compare_exchange_weak(head, info, std::memory_order_release,
+                                               std::memory_order_relaxed));
+    }
 
+    // Appends every queued completion to out, oldest first.
+    void takeAll(std::deque<ThreadInfo<R> *> &out) {
+        ThreadInfo<R> *head = m_head.exchange(nullptr, std::memory_order_acquire);
+        size_t first = out.size();
+        for (; head != nullptr; head = head->next_completed) {
+            out.push_back(head);
+        }
+        std::reverse(out.begin() + first, out.end());
+    }
+
+    bool hasItems() const { return m_head.load(std::memory_order_acquire) != nullptr; }
+
+  private:
+    std::atomic<ThreadInfo<R> *> m_head{nullptr};
+};
+
+template <typename R = bool>
 class ThreadMgt {
     private:
-        std::map<std::string, ThreadInfo> m_thread_map;
+        ConcurrentRegistry<ThreadInfo<R>> m_thread_map;
+        CompletionQueue<R> m_completion;
+        std::atomic<size_t> m_running{0};
+
+        // Waiters sleep on m_wake_cv; producers only touch the mutex when
+        // somebody is actually sleeping.
+        std::mutex m_wake_mutex;
+        std::condition_variable m_wake_cv;
+        std::atomic<size_t> m_sleepers{0};
+
+        // Consumer side: completions taken from the queue but not yet handed out.
+        std::mutex m_consume_mutex;
+        std::deque<ThreadInfo<R> *> m_pending;
+
+        void finish(ThreadInfo<R> &info, TaskStatus status);
+        static void markTimedOut(ThreadInfo<R> &info);
+        template <typename Pred>
+        bool waitUntil(std::chrono::steady_clock::time_point deadline, Pred pred);
 
     public:
-        std::optional<std::reference_wrapper<bool>> getStopFlag(const std::string t_name);
-        bool registerThread(const std::string t_name, std::future<bool> &future);
-        bool Join(const std::string t_name, const int wait_time = 0);
+        using Task = std::function<R(std::stop_token)>;
+
+        ~ThreadMgt();
+
+        std::optional<std::stop_token> getStopToken(const std::string t_name);
+        bool registerThread(const std::string t_name, Task task);
+        bool Join(const std::string t_name,
+                  const std::chrono::milliseconds wait_time = std::chrono::milliseconds(0));
+        bool JoinAll(const std::chrono::milliseconds wait_time);
+        const ThreadInfo<R> *JoinAny(const std::chrono::milliseconds wait_time);
+
+        // Calls f(const ThreadInfo<R> &) for every completed task not handed
+        // out yet, in completion order, and returns how many were drained.
+        template <typename F>
+        size_t Drain(F &&f);
 };
 
  
 
-std::optional<std::reference_wrapper<bool>> ThreadMgt::getStopFlag(const std::string t_name) {
-    try {
-        ThreadInfo info;
-        m_thread_map[t_name] = std::move(info);
-        m_thread_map[t_name].stop_flag = false;
-        m_thread_map[t_name].status = "Not Running";
-        return m_thread_map[t_name].stop_flag;
-    } catch (std::exception &e) {
+template <typename R>
+ThreadMgt<R>::~ThreadMgt() {
+    // Ask every task to stop first so the joins below overlap. Join here
+    // rather than in ~ThreadInfo: finishing tasks still use the members
+    // declared after m_thread_map.
+    m_thread_map.forEach([](std::string_view, const std::shared_ptr<ThreadInfo<R>> &info) {
+        info->stop.request_stop();
+    });
+    m_thread_map.forEach([](std::string_view, const std::shared_ptr<ThreadInfo<R>> &info) {
+        if (info->thread.joinable()) {
+            info->thread.join();
+        }
+    });
+}
+
+template <typename R>
+std::optional<std::stop_token> ThreadMgt<R>::getStopToken(const std::string t_name) {
+    auto info = m_thread_map.find(t_name);
+    if (!info) {
         return std::nullopt;
     }
+    return info->stop.get_token();
 }
 
-bool ThreadMgt::registerThread(const std::string t_name, std::future<bool> &future) {
-    try {
-        m_thread_map[t_name].t_name = t_name;
-        m_thread_map[t_name].future = std::move(future);
-        m_thread_map[t_name].status = "Running";
-    } catch (const std::exception &e) {
-        m_thread_map[t_name].error = e.what();
+template <typename R>
+void ThreadMgt<R>::finish(ThreadInfo<R> &info, TaskStatus status) {
+    info.status.store(status, std::memory_order_relaxed);
+    info.finished.store(true, std::memory_order_release);
+    m_completion.push(&info);
+    m_running.fetch_sub(1);
+    if (m_sleepers.load() > 0) {
+        { std::lock_guard<std::mutex> lock(m_wake_mutex); }
+        m_wake_cv.notify_all();
     }
+}
+
+// A task may finish between the caller's check and here; only a task that
+// is still Running becomes TimedOut, so a result is never hidden behind it.
+// One that finishes later still ends up Done or Error through finish().
+template <typename R>
+void ThreadMgt<R>::markTimedOut(ThreadInfo<R> &info) {
+    TaskStatus expected = TaskStatus::Running;
+    if (info.status.compare_exchange_strong(expected, TaskStatus::TimedOut)) {
+        info.metrics.recordOverrun();
+    }
+}
+
+template <typename R>
+template <typename Pred>
+bool ThreadMgt<R>::waitUntil(std::chrono::steady_clock::time_point deadline, Pred pred) {
+    if (pred()) {
+        return true;
+    }
+    m_sleepers.fetch_add(1);
+    std::unique_lock<std::mutex> lock(m_wake_mutex);
+    bool ok = m_wake_cv.wait_until(lock, deadline, pred);
+    m_sleepers.fetch_sub(1);
+    return ok;
+}
+
+template <typename R>
+bool ThreadMgt<R>::registerThread(const std::string t_name, Task task) {
+    auto info = std::make_shared<ThreadInfo<R>>();
+    info->t_name = t_name;
+    info->metrics = JobMetricsRegistry::global().add(t_name);
+    info->status = TaskStatus::Running;
+    auto registered = std::chrono::steady_clock::now();
 
-    if (m_thread_map[t_name].error.empty()) {
+    // Everything but the thread is set up before the entry becomes visible
+    // to Join and friends. The registry never overwrites an existing task.
+    m_running.fetch_add(1);
+    if (!m_thread_map.insert(t_name, info)) {
+        m_running.fetch_sub(1);
         return false;
     }
 
-    m_thread_map.at(t_name).error.clear();
+    try {
+        // The registry keeps info alive for as long as this ThreadMgt, and
+        // ~ThreadMgt joins the thread before the registry goes away.
+        info->thread = std::jthread([this, raw = info.get(), task = std::move(task),
+                                     registered, st = info->stop.get_token()] {
+            auto start = std::chrono::steady_clock::now();
+            TaskStatus status = TaskStatus::Done;
+            try {
+                raw->result.emplace(task(st));
+            } catch (...) {
+                raw->error = std::current_exception();
+                status = TaskStatus::Error;
+            }
+            raw->metrics.recordRun(std::chrono::steady_clock::now() - start,
+                                   start - registered);
+            finish(*raw, status);
+        });
+    } catch (...) {
+        info->error = std::current_exception();
+        finish(*info, TaskStatus::Error);
+        return false;
+    }
     return true;
 }
 
-bool ThreadMgt::Join(const std::string t_name, const int wait_time) {
-    try {
+template <typename R>
+bool ThreadMgt<R>::Join(const std::string t_name, const std::chrono::milliseconds wait_time) {
+    auto info = m_thread_map.find(t_name);
+    if (!info) {
+        return false;
+    }
 
-        if (m_thread_map.at(t_name).future.valid()) {
-            
-            if (0 == wait_time) {
-                m_thread_map.at(t_name).future.wait();
-                m_thread_map[t_name].status = "Done";
-                m_thread_map[t_name].result =
-                    m_thread_map.at(t_name).future.get();
-            } else {
-                m_thread_map.at(t_name).stop_flag = true;
-                std::future_status status = m_thread_map.at(t_name).future.wait_for(
-                        std::chrono::seconds(wait_time));
-                if (status == std::future_status::ready) {
-                    m_thread_map[t_name].status = "Done";
-                    m_thread_map[t_name].result =
-                        m_thread_map.at(t_name).future.get();
-                } else {
-                    m_thread_map[t_name].status = "Error";
-                    m_thread_map.at(t_name).error =
-                        "Task did not complete within the given time";
-                    return false;
-                }
-            }
-        } else {
-            m_thread_map[t_name].status = "Error";
-            m_thread_map.at(t_name).error = "Task is not managed";
+    auto finished = [&info]() { return info->finished.load(std::memory_order_acquire); };
+    if (0 == wait_time.count()) {
+        waitUntil(std::chrono::steady_clock::time_point::max(), finished);
+    } else {
+        info->stop.request_stop();
+        if (!waitUntil(std::chrono::steady_clock::now() + wait_time, finished)) {
+            markTimedOut(*info);
             return false;
         }
-    } catch (const std::exception &e) {
-        m_thread_map[t_name].status = "Error";
-        m_thread_map.at(t_name).error = e.what();
     }
+    info->collected = true;
+    return info->status == TaskStatus::Done;
+}
 
-    if (not m_thread_map.at(t_name).error.empty()) {
-        return false;
+template <typename R>
+bool ThreadMgt<R>::JoinAll(const std::chrono::milliseconds wait_time) {
+    auto deadline = std::chrono::steady_clock::now() + wait_time;
+
+    // Request stop on every task at once; the wait below is bounded by
+    // the slowest task, not by the sum of per-task timeouts.
+    m_thread_map.forEach([](std::string_view, const std::shared_ptr<ThreadInfo<R>> &info) {
+        info->stop.request_stop();
+    });
+    waitUntil(deadline, [this]() { return m_running.load() == 0; });
+
+    bool all_done = true;
+    m_thread_map.forEach([&all_done](std::string_view, const std::shared_ptr<ThreadInfo<R>> &info) {
+        if (!info->finished.load(std::memory_order_acquire)) {
+            markTimedOut(*info);
+        }
+        all_done = all_done && info->status == TaskStatus::Done;
+    });
+    return all_done;
+}
+
+template <typename R>
+const ThreadInfo<R> *ThreadMgt<R>::JoinAny(const std::chrono::milliseconds wait_time) {
+    auto deadline = std::chrono::steady_clock::now() + wait_time;
+    std::lock_guard<std::mutex> lock(m_consume_mutex);
+    for (;;) {
+        m_completion.takeAll(m_pending);
+        while (!m_pending.empty()) {
+            ThreadInfo<R> *info = m_pending.front();
+            m_pending.pop_front();
+            // Skip tasks that were already joined individually.
+            if (!info->collected.exchange(true)) {
+                return info;
+            }
+        }
+        if (!waitUntil(deadline, [this]() { return m_completion.hasItems(); })) {
+            return nullptr;
+        }
     }
+}
 
-    m_thread_map.at(t_name).error.clear();
-    return true;
+template <typename R>
+template <typename F>
+size_t ThreadMgt<R>::Drain(F &&f) {
+    std::lock_guard<std::mutex> lock(m_consume_mutex);
+    m_completion.takeAll(m_pending);
+    size_t drained = 0;
+    for (ThreadInfo<R> *info : m_pending) {
+        if (!info->collected.exchange(true)) {
+            f(static_cast<const ThreadInfo<R> &>(*info));
+            ++drained;
+        }
+    }
+    m_pending.clear();
+    return drained;
 }
 
-bool longRunningTask(bool &stop_flag) {
+bool longRunningTask(std::stop_token stop_token) {
     int cnt = 0, max = 10;
-    while (not stop_flag) {
+    while (not stop_token.stop_requested()) {
         if (cnt++ == max) {
             break;
         }
-        std::cout << "stop flag : " << stop_flag << std::endl;
+        std::cout << "stop requested : " << stop_token.stop_requested() << std::endl;
         std::this_thread::sleep_for(std::chrono::seconds(1));
     }
-    std::cout << "End : stop flag " << stop_flag << std::endl;
+    std::cout << "End : stop requested " << stop_token.stop_requested() << std::endl;
     return true;
 }
 
 int main(int argc, char const *argv[]) {
-    ThreadMgt tmgt;
-    auto opt = tmgt.getStopFlag("test");
-    if (not opt.has_value()) {
+    ThreadMgt<bool> tmgt;
+    if (not tmgt.registerThread("test", longRunningTask)) {
         return false;
     }
-    bool &stop_flag = opt->get();
-    std::cout << stop_flag << std::endl;
-    std::future<bool> future =
-        std::async(std::launch::async, longRunningTask, std::ref(stop_flag));
-
-    tmgt.registerThread("test", future);
     std::this_thread::sleep_for(std::chrono::seconds(5));
-    tmgt.Join("test", 5);
+    tmgt.Join("test", std::chrono::milliseconds(5000));
+
+    // Typed results: completions are drained in batches without name
+    // lookups or converting results to strings.
+    ThreadMgt<int> workers;
+    for (int i = 0; i < 100; i++) {
+        workers.registerThread("worker" + std::to_string(i), [i](std::stop_token st) {
+            for (int n = 0; n < i * 100 && not st.stop_requested(); n++) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            return i;
+        });
+    }
+    if (auto first = workers.JoinAny(std::chrono::milliseconds(1000))) {
+        std::cout << "First finished : " << first->t_name << " -> " << *first->result
+                  << std::endl;
+    }
+
+    // Shut down many tasks at once: JoinAll takes as long as the slowest one.
+    auto begin = std::chrono::steady_clock::now();
+    bool all_done = workers.JoinAll(std::chrono::milliseconds(1000));
+    std::cout << "JoinAll : " << all_done << " in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - begin)
+                     .count()
+              << "ms" << std::endl;
+
+    long sum = 0;
+    size_t drained = workers.Drain([&sum](const ThreadInfo<int> &info) {
+        if (info.status == TaskStatus::Done) {
+            sum += *info.result;
+        }
+    });
+    std::cout << "Drained " << drained << " results, sum " << sum << std::endl;
+
+    // Prometheus text format; ex_webserver serves the same dump at /metrics.
+    if (argc > 1 && std::string(argv[1]) == "--metrics") {
+        std::cout << JobMetricsRegistry::global().prometheus();
+    }
     return 0;
 }
@@ -0,0 +1,407 @@
+#include "http_server.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// wrk-style load generator: keeps `connections` requests in flight against
+// an in-process HttpServer for a fixed time and reports requests/sec and
+// latency percentiles, for every server thread count up to the core count.
+
+using Clock = std::chrono::steady_clock;
+
+// Every operator new in the process, for --alloc. Kept out of line so GCC
+// doesn't pair inlined malloc/free against new/delete expressions.
+static std::atomic<uint64_t> g_allocations{0};
+
+__attribute__((noinline)) void *operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size != 0 ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+__attribute__((noinline)) void operator delete(void *p) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+class Connection : public std::enable_shared_from_this<Connection> {
+    beast::tcp_stream stream_;
+    tcp::endpoint endpoint_;
+    beast::flat_buffer buffer_;
+    http::request<http::empty_body> req_;
+    http::response<http::string_body> res_;
+    Clock::time_point deadline_;
+    Clock::time_point sent_;
+    std::vector<uint32_t> &latencies_us_;
+    uint64_t &errors_;
+
+  public:
+    Connection(net::io_context &ioc, tcp::endpoint endpoint, const std::string &target,
+               Clock::time_point deadline, std::vector<uint32_t> &latencies_us,
+               uint64_t &errors)
+        : stream_(ioc), endpoint_(endpoint), deadline_(deadline),
+          latencies_us_(latencies_us), errors_(errors) {
+        req_.method(http::verb::get);
+        req_.target(target);
+        req_.version(11);
+        req_.set(http::field::host, "localhost");
+        req_.keep_alive(true);
+    }
+
+    void run() { connect(); }
+
+  private:
+    void connect() {
+        if (Clock::now() >= deadline_)
+            return;
+        stream_.expires_after(std::chrono::seconds(5));
+        stream_.async_connect(endpoint_, [self = shared_from_this()](beast::error_code ec) {
+            if (ec) {
+                ++self->errors_;
+                return self->connect();
+            }
+            self->send();
+        });
+    }
+
+    void send() {
+        if (Clock::now() >= deadline_)
+            return;
+        sent_ = Clock::now();
+        stream_.expires_after(std::chrono::seconds(5));
+        http::async_write(stream_, req_,
+                          [self = shared_from_this()](beast::error_code ec, std::size_t) {
+                              if (ec)
+                                  return self->reconnect(true);
+                              self->receive();
+                          });
+    }
+
+    void receive() {
+        res_ = {};
+        http::async_read(stream_, buffer_, res_,
+                         [self = shared_from_this()](beast::error_code ec, std::size_t) {
+                             if (ec)
+                                 return self->reconnect(true);
+                             self->latencies_us_.push_back(static_cast<uint32_t>(
+                                 std::chrono::duration_cast<std::chrono::microseconds>(
+                                     Clock::now() - self->sent_)
+                                     .count()));
+                             if (self->res_.keep_alive())
+                                 self->send();
+                             else
+                                 self->reconnect(false);
+                         });
+    }
+
+    void reconnect(bool failed) {
+        if (failed)
+            ++errors_;
+        beast::error_code ec;
+        stream_.socket().shutdown(tcp::socket::shutdown_both, ec);
+        stream_.close();
+        buffer_.clear();
+        connect();
+    }
+};
+
+struct LoadResult {
+    double requests_per_sec;
+    uint32_t p50_us;
+    uint32_t p99_us;
+    uint64_t errors;
+};
+
+LoadResult runLoad(unsigned short port, const std::string &target, size_t connections,
+                   size_t client_threads, std::chrono::milliseconds duration) {
+    tcp::endpoint endpoint(net::ip::make_address("127.0.0.1"), port);
+    auto start = Clock::now();
+    auto deadline = start + duration;
+
+    // One io_context per client thread; each owns its connections' stats.
+    std::vector<std::unique_ptr<net::io_context>> contexts;
+    std::vector<std::vector<uint32_t>> latencies(client_threads);
+    std::vector<uint64_t> errors(client_threads, 0);
+    for (size_t t = 0; t < client_threads; ++t) {
+        contexts.push_back(std::make_unique<net::io_context>(1));
+    }
+    for (size_t c = 0; c < connections; ++c) {
+        size_t t = c % client_threads;
+        std::make_shared<Connection>(*contexts[t], endpoint, target, deadline, latencies[t],
+                                     errors[t])
+            ->run();
+    }
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < client_threads; ++t) {
+        threads.emplace_back([&contexts, t] { contexts[t]->run(); });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::vector<uint32_t> all;
+    LoadResult result{0, 0, 0, 0};
+    for (size_t t = 0; t < client_threads; ++t) {
+        all.insert(all.end(), latencies[t].begin(), latencies[t].end());
+        result.errors += errors[t];
+    }
+    if (!all.empty()) {
+        std::sort(all.begin(), all.end());
+        result.requests_per_sec = all.size() / seconds;
+        result.p50_us = all[all.size() / 2];
+        result.p99_us = all[all.size() * 99 / 100];
+    }
+    return result;
+}
+
+void registerBenchRoutes(HttpServer &server) {
+    for (auto [path, dispatch] : {std::pair{"/bench", Dispatch::Inline},
+                                  std::pair{"/bench/cached", Dispatch::Cached}}) {
+        server.route(http::verb::get, path, [](const Request &, Response &res) {
+            res.set(http::field::content_type, "text/plain");
+            res.body().assign(1024, 'x');
+        }, dispatch);
+    }
+}
+
+// Blocking client on raw sockets, so that it allocates nothing itself.
+// Sends `depth` pipelined requests at a time and reads the responses back,
+// which all have the same size.
+class RawClient {
+  public:
+    RawClient(unsigned short port, const std::string &target, size_t depth,
+              const std::string &headers = "")
+        : depth_(depth) {
+        fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        ::setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (::connect(fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0)
+            throw std::runtime_error("connect failed");
+
+        std::string one_request =
+            "GET " + target + " HTTP/1.1\r\nHost: bench\r\n" + headers + "\r\n";
+        for (size_t i = 0; i < depth_; ++i) {
+            batch_ += one_request;
+        }
+
+        // Learn the response size from a single request.
+        sendAll(one_request.data(), one_request.size());
+        size_t got = 0;
+        const char *end = nullptr;
+        while (end == nullptr) {
+            got += recvSome(buffer_ + got, sizeof(buffer_) - got);
+            buffer_[got] = '\0';
+            end = std::strstr(buffer_, "\r\n\r\n");
+        }
+        const char *length = strcasestr(buffer_, "Content-Length:");
+        size_t body = length != nullptr ? std::strtoul(length + 15, nullptr, 10) : 0;
+        response_size_ = static_cast<size_t>(end + 4 - buffer_) + body;
+        if (response_size_ * depth_ > sizeof(buffer_))
+            throw std::runtime_error("response too large");
+        readExactly(response_size_, got);
+    }
+
+    ~RawClient() { ::close(fd_); }
+
+    // Runs at least `requests` requests.
+    void run(size_t requests) {
+        for (size_t done = 0; done < requests; done += depth_) {
+            sendAll(batch_.data(), batch_.size());
+            readExactly(response_size_ * depth_, 0);
+        }
+    }
+
+  private:
+    void sendAll(const char *data, size_t size) {
+        while (size > 0) {
+            ssize_t n = ::send(fd_, data, size, MSG_NOSIGNAL);
+            if (n <= 0)
+                throw std::runtime_error("send failed");
+            data += n;
+            size -= static_cast<size_t>(n);
+        }
+    }
+
+    size_t recvSome(char *data, size_t size) {
+        ssize_t n = ::recv(fd_, data, size - 1, 0);
+        if (n <= 0)
+            throw std::runtime_error("connection closed");
+        return static_cast<size_t>(n);
+    }
+
+    void readExactly(size_t size, size_t got) {
+        while (got < size) {
+            got += recvSome(buffer_ + got, size - got + 1);
+        }
+    }
+
+    int fd_;
+    size_t depth_;
+    std::string batch_;
+    size_t response_size_ = 0;
+    char buffer_[256 * 1024];
+};
+
+// Counts heap allocations per request once the server is warmed up.
+// Sessions, arenas and operation state are all recycled by then, so a
+// non-zero count is a regression.
+int checkAllocations() {
+    HttpServer server(0, 1, HttpServer::Mode::ReusePort);
+    registerBenchRoutes(server);
+    std::thread server_thread([&server] { server.run(); });
+
+    const size_t kRequests = 20000;
+    int status = 0;
+    std::cout << "target          encoding  pipeline  allocations/request" << std::endl;
+    for (const char *target : {"/bench", "/bench/cached", "/missing"}) {
+        for (const char *encoding : {"identity", "gzip"}) {
+            for (size_t depth : {1, 16}) {
+                auto client = std::make_unique<RawClient>(
+                    server.port(), target, depth,
+                    std::string("Accept-Encoding: ") + encoding + "\r\n");
+                client->run(1000);  // warm-up
+
+                uint64_t before = g_allocations.load();
+                client->run(kRequests);
+                double per_request =
+                    static_cast<double>(g_allocations.load() - before) / kRequests;
+
+                std::printf("%-14s  %-8s  %-8zu  %.4f\n", target, encoding, depth,
+                            per_request);
+                if (per_request != 0)
+                    status = 1;
+            }
+        }
+    }
+
+    server.stop();
+    server_thread.join();
+    return status;
+}
+
+// Sends one HEAD and one GET for the same target back to back on one
+// connection and returns everything the server wrote until it closed.
+std::string exchangeHeadGet(unsigned short port, const std::string &target) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    timeval timeout{2, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+        ::close(fd);
+        throw std::runtime_error("connect failed");
+    }
+
+    std::string request = " " + target + " HTTP/1.1\r\nHost: bench\r\n\r\n";
+    std::string both = "HEAD" + request + "GET" + request;
+    ::send(fd, both.data(), both.size(), MSG_NOSIGNAL);
+    // The server closes after the GET once it sees our end of stream.
+    ::shutdown(fd, SHUT_WR);
+
+    std::string reply;
+    char chunk[4096];
+    ssize_t n;
+    while ((n = ::recv(fd, chunk, sizeof(chunk), 0)) > 0) {
+        reply.append(chunk, static_cast<size_t>(n));
+    }
+    ::close(fd);
+    return reply;
+}
+
+// Splits off one response head; returns its status line and Content-Length.
+bool takeHead(std::string &reply, std::string &status, size_t &length) {
+    size_t end = reply.find("\r\n\r\n");
+    if (reply.compare(0, 9, "HTTP/1.1 ") != 0 || end == std::string::npos)
+        return false;
+    std::string head = reply.substr(0, end + 4);
+    reply.erase(0, end + 4);
+    status = head.substr(0, head.find("\r\n"));
+    const char *field = strcasestr(head.c_str(), "Content-Length:");
+    length = field != nullptr ? std::strtoul(field + 15, nullptr, 10) : 0;
+    return true;
+}
+
+// HEAD answers must be the GET head without the body, or a pipelined
+// response after them is misread on a keep-alive connection. Covers a
+// built route, a cached one, the cached 404 and a 405.
+int checkHead() {
+    HttpServer server(0, 1, HttpServer::Mode::ReusePort);
+    registerBenchRoutes(server);
+    server.route(http::verb::post, "/bench/post", [](const Request &, Response &res) {
+        res.set(http::field::content_type, "text/plain");
+        res.body() = "posted\n";
+    });
+    std::thread server_thread([&server] { server.run(); });
+
+    int status = 0;
+    std::cout << "target          HEAD status                       Content-Length  result" << std::endl;
+    for (const char *target : {"/bench", "/bench/cached", "/missing", "/bench/post"}) {
+        std::string reply = exchangeHeadGet(server.port(), target);
+        std::string head_status, get_status;
+        size_t head_length = 0, get_length = 0;
+        bool ok = takeHead(reply, head_status, head_length) &&
+                  takeHead(reply, get_status, get_length) && head_status == get_status &&
+                  head_length == get_length && reply.size() == get_length;
+
+        std::printf("%-14s  %-32s  %-14zu  %s\n", target, head_status.c_str(), head_length,
+                    ok ? "ok" : "out of sync");
+        if (!ok)
+            status = 1;
+    }
+
+    server.stop();
+    server_thread.join();
+    return status;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && std::strcmp(argv[1], "--alloc") == 0)
+        return checkAllocations();
+    if (argc > 1 && std::strcmp(argv[1], "--head") == 0)
+        return checkHead();
+
+    // ./ex_webserver_bench [target] [connections] [seconds per run]
+    // ./ex_webserver_bench --alloc
+    // ./ex_webserver_bench --head
+    // Targets: /bench (built per request), /bench/cached (pre-serialized),
+    // anything else is a (cached) 404.
+    const std::string target = argc > 1 ? argv[1] : "/bench";
+    const size_t connections = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 64;
+    const auto duration = std::chrono::milliseconds(
+        argc > 3 ? std::atoi(argv[3]) * 1000 : 2000);
+    const size_t cores = std::max(1u, std::thread::hardware_concurrency());
+
+    std::cout << "mode        threads  req/s      p50(us)  p99(us)  errors" << std::endl;
+    for (auto mode : {HttpServer::Mode::ReusePort, HttpServer::Mode::SharedContext}) {
+        for (size_t threads = 1;; threads = std::min(threads * 2, cores)) {
+            HttpServer server(0, threads, mode);
+            registerBenchRoutes(server);
+            std::thread server_thread([&server] { server.run(); });
+
+            LoadResult r = runLoad(server.port(), target, connections, cores, duration);
+
+            server.stop();
+            server_thread.join();
+
+            std::cout << (mode == HttpServer::Mode::ReusePort ? "reuseport" : "shared   ")
+                      << "   " << threads << "\t     " << static_cast<uint64_t>(r.requests_per_sec)
+                      << "\t" << r.p50_us << "\t " << r.p99_us << "\t  " << r.errors << std::endl;
+            if (threads == cores)
+                break;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,746 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/version.hpp>
+#include <boost/config.hpp>
+#include <boost/smart_ptr/intrusive_ptr.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "arena.hpp"
+#include "compression.hpp"
+#include "job_metrics.hpp"
+#include "router.hpp"
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace net = boost::asio;
+using tcp = boost::asio::ip::tcp;
+
+// Fields and bodies are allocated from the session's per-request Arena.
+// Bodies are std::basic_string with ArenaAllocator: fill them with
+// `body() = "..."`, `body().assign(data, size)` or `body().append(...)`.
+using Body = http::basic_string_body<char, std::char_traits<char>, ArenaAllocator<char>>;
+using Fields = http::basic_fields<ArenaAllocator<char>>;
+using Request = http::request<Body, Fields>;
+using Response = http::response<Body, Fields>;
+
+// Fills in the response for a request. prepare_payload() is done by the session.
+// params holds the `{name}` segments of the route pattern.
+using Handler = std::function<void(const Request &, Response &, const PathParams &params)>;
+// Same, for routes that don't look at path parameters.
+using SimpleHandler = std::function<void(const Request &, Response &)>;
+
+enum class Dispatch {
+    Inline,    // cheap handler, runs on the I/O thread
+    Blocking,  // may block or burn CPU, runs on the BlockingPool
+    Cached,    // handler output is serialized once and replayed until invalidated
+};
+
+// A complete response (status line, headers and body) serialized once per
+// content coding. Heads are kept for HTTP/1.0 and 1.1 with and without
+// keep-alive, plus the matching 304 heads, so serving it never touches the
+// header map.
+struct SerializedResponse {
+    struct Variant {
+        std::string etag;
+        std::string body;
+        std::string heads[2][2];         // [HTTP/1.1][keep-alive]
+        std::string not_modified[2][2];  // 304 heads, same indexing
+
+        // True when the If-None-Match header matches this variant's ETag.
+        bool matches(beast::string_view if_none_match) const {
+            return if_none_match == "*" ||
+                   if_none_match.find(etag) != beast::string_view::npos;
+        }
+    };
+
+    // Indexed by Encoding. Only the identity variant is filled in when the
+    // body is not worth compressing; it then serves every request.
+    Variant variants[kEncodings];
+    bool compressed = false;
+
+    SerializedResponse(Response prototype, uint64_t generation,
+                       const CompressionOptions &options) {
+        if (prototype.find(http::field::server) == prototype.end())
+            prototype.set(http::field::server, BOOST_BEAST_VERSION_STRING);
+        std::string identity(prototype.body().data(), prototype.body().size());
+        std::string tag = std::to_string(generation) + "-" +
+                          std::to_string(std::hash<std::string>{}(identity));
+
+        if (worthCompressing(prototype, options)) {
+            varyOnEncoding(prototype);
+            for (Encoding encoding : {Encoding::Gzip, Encoding::Deflate}) {
+                Variant &v = variants[static_cast<size_t>(encoding)];
+                Deflater::forThread().compress(identity.data(), identity.size(), encoding,
+                                               options.static_level, v.body);
+                // Each coding is its own representation, with its own ETag.
+                prototype.set(http::field::content_encoding, toString(encoding));
+                fill(v, prototype, "\"" + tag + "-" + toString(encoding) + "\"");
+            }
+            prototype.erase(http::field::content_encoding);
+            compressed = true;
+        }
+        variants[0].body = std::move(identity);
+        fill(variants[0], prototype, "\"" + tag + "\"");
+    }
+
+    const Variant &variant(Encoding encoding) const {
+        return compressed ? variants[static_cast<size_t>(encoding)] : variants[0];
+    }
+
+  private:
+    // Serializes the heads for v.body, which is already set.
+    static void fill(Variant &v, Response &prototype, std::string etag) {
+        v.etag = std::move(etag);
+        prototype.set(http::field::etag, v.etag);
+        prototype.content_length(v.body.size());
+        for (int v11 = 0; v11 < 2; ++v11) {
+            for (int keep_alive = 0; keep_alive < 2; ++keep_alive) {
+                prototype.version(v11 ? 11 : 10);
+                prototype.keep_alive(keep_alive != 0);
+                v.heads[v11][keep_alive] = serialize(prototype.base());
+
+                Response head{http::status::not_modified, prototype.version()};
+                head.set(http::field::server, BOOST_BEAST_VERSION_STRING);
+                head.set(http::field::etag, v.etag);
+                if (prototype.find(http::field::vary) != prototype.end())
+                    head.set(http::field::vary, prototype[http::field::vary]);
+                head.keep_alive(keep_alive != 0);
+                v.not_modified[v11][keep_alive] = serialize(head.base());
+            }
+        }
+    }
+
+    static std::string serialize(const Response::header_type &head) {
+        std::ostringstream os;
+        os << head;
+        return os.str();
+    }
+};
+
+// Caches the output of a Dispatch::Cached handler. invalidate() drops the
+// serialized copy; the next request rebuilds it with a new ETag.
+class ResponseCache {
+  public:
+    explicit ResponseCache(Handler generator) : generator_(std::move(generator)) {}
+
+    std::shared_ptr<const SerializedResponse> get(const CompressionOptions &options) {
+        uint64_t generation;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (current_)
+                return current_;
+            generation = generation_;
+        }
+
+        Response res;
+        generator_(Request(), res, PathParams());
+        auto built =
+            std::make_shared<const SerializedResponse>(std::move(res), generation, options);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        // Don't publish a copy built from data that was invalidated meanwhile.
+        if (generation == generation_ && !current_)
+            current_ = built;
+        return built;
+    }
+
+    void invalidate() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        current_.reset();
+        ++generation_;
+    }
+
+  private:
+    Handler generator_;
+    std::mutex mutex_;
+    std::shared_ptr<const SerializedResponse> current_;
+    uint64_t generation_ = 0;
+};
+
+struct Route {
+    http::verb method;
+    std::string path;
+    Handler handler;
+    Dispatch dispatch;
+    std::shared_ptr<ResponseCache> cache;  // Dispatch::Cached only
+    std::shared_ptr<JobMetrics> metrics;   // Dispatch::Blocking only
+};
+
+// Fixed set of threads with a bounded queue for Dispatch::Blocking routes.
+// When the queue is full trySubmit() fails right away so the session can
+// answer 503 instead of piling up work behind a slow backend.
+class BlockingPool {
+  public:
+    BlockingPool(size_t threads, size_t max_queue) : max_queue_(max_queue) {
+        for (size_t i = 0; i < std::max<size_t>(threads, 1); ++i) {
+            threads_.emplace_back([this] { work(); });
+        }
+    }
+
+    // Drops queued jobs and waits for running ones.
+    ~BlockingPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+            queue_.clear();
+        }
+        cv_.notify_all();
+        for (auto &thread : threads_) {
+            thread.join();
+        }
+    }
+
+    bool trySubmit(std::function<void()> job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_ || queue_.size() >= max_queue_)
+                return false;
+            queue_.push_back(std::move(job));
+        }
+        cv_.notify_one();
+        return true;
+    }
+
+  private:
+    void work() {
+        for (;;) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+                if (stopping_)
+                    return;
+                job = std::move(queue_.front());
+                queue_.pop_front();
+            }
+            job();
+        }
+    }
+
+    const size_t max_queue_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> queue_;
+    bool stopping_ = false;
+    std::vector<std::thread> threads_;
+};
+
+// State shared by every session of one HttpServer.
+struct ServerState {
+    RadixRouter<Route> routes;
+    std::unique_ptr<BlockingPool> blocking;
+    CompressionOptions compression;
+    ResponseCache not_found{[](const Request &, Response &res, const PathParams &) {
+        res.result(http::status::not_found);
+        res.set(http::field::content_type, "text/plain");
+        res.body() = "404 Not Found\n";
+    }};
+};
+
+class SessionPool;
+
+// One connection. Sessions are reference counted by their pending handlers
+// and go back to their SessionPool when the last one is done, keeping the
+// read buffer and arena blocks for the next connection.
+class HttpSession {
+    // Connections that make no progress for this long are closed.
+    static constexpr std::chrono::seconds kIdleTimeout{30};
+
+    using Clock = net::steady_timer::clock_type;
+
+    std::atomic<size_t> refs_{0};
+    std::atomic<uint64_t> connection_{0};  // bumped on reset(), for stale timers
+    SessionPool &pool_;
+    ServerState &server_;
+    Arena arena_;  // req_ and res_ allocate from here
+    beast::tcp_stream stream_;
+    // One idle timer per connection; requests only move deadline_, so they
+    // don't cancel and re-arm a timer each time.
+    net::steady_timer timer_;
+    Clock::time_point deadline_;
+    beast::flat_buffer buffer_;
+    std::optional<Request> req_;
+    std::optional<Response> res_;
+    // Writes only the head of res_ when answering HEAD.
+    std::optional<http::response_serializer<Body, Fields>> head_;
+    PathParams params_;  // views into req_->target()
+    Encoding encoding_ = Encoding::Identity;  // negotiated for the current request
+
+  public:
+    using Ptr = boost::intrusive_ptr<HttpSession>;
+
+    // In SharedContext mode the executor is a strand of its own.
+    HttpSession(net::any_io_executor executor, ServerState &server, SessionPool &pool)
+        : pool_(pool), server_(server), stream_(executor), timer_(executor) {}
+
+    // The socket to accept the next connection into.
+    tcp::socket &socket() { return stream_.socket(); }
+
+    // Where every handler of the session runs: its strand in SharedContext
+    // mode. The socket's own executor is the bare io_context.
+    net::any_io_executor executor() { return stream_.get_executor(); }
+
+    void run() {
+        // Responses are written whole; don't let Nagle hold back the next one.
+        beast::error_code ec;
+        stream_.socket().set_option(tcp::no_delay(true), ec);
+        deadline_ = Clock::now() + kIdleTimeout;
+        waitIdle(connection_.load(std::memory_order_relaxed));
+        readRequest();
+    }
+
+    // Called by the pool once no handler refers to the session any more.
+    void reset() {
+        connection_.fetch_add(1, std::memory_order_relaxed);
+        timer_.cancel();
+        stream_.close();
+        buffer_.clear();
+        head_.reset();
+        req_.reset();
+        res_.reset();
+        arena_.reset();
+    }
+
+  private:
+    friend void intrusive_ptr_add_ref(HttpSession *session) {
+        session->refs_.fetch_add(1, std::memory_order_relaxed);
+    }
+    friend void intrusive_ptr_release(HttpSession *session);
+
+    // The timer holds no reference, so a finished connection is recycled
+    // right away; a wait that outlives it sees a newer connection_ or an
+    // aborted wait and leaves the session alone.
+    void waitIdle(uint64_t connection) {
+        timer_.expires_at(deadline_);
+        timer_.async_wait(recycled([this, connection](beast::error_code ec) {
+            if (ec == net::error::operation_aborted ||
+                connection_.load(std::memory_order_relaxed) != connection)
+                return;
+            if (Clock::now() < deadline_)
+                return waitIdle(connection);
+            // Fails the pending read or write, which drops the last reference.
+            stream_.socket().close(ec);
+        }));
+    }
+
+    // The buffer lives as long as the connection, the messages as long as
+    // one request. Pipelined requests that arrived together stay in buffer_
+    // and are parsed without another socket read; responses go out in
+    // request order.
+    void readRequest() {
+        Ptr self(this);
+
+        // Destroy the previous messages before rewinding the arena under them.
+        head_.reset();
+        req_.reset();
+        res_.reset();
+        arena_.reset();
+        ArenaAllocator<char> alloc(arena_);
+        req_.emplace(std::piecewise_construct, std::make_tuple(alloc), std::make_tuple(alloc));
+        res_.emplace(std::piecewise_construct, std::make_tuple(alloc), std::make_tuple(alloc));
+
+        deadline_ = Clock::now() + kIdleTimeout;
+        http::async_read(
+            stream_, buffer_, *req_,
+            recycled([self](beast::error_code ec, std::size_t bytes_transferred) {
+                boost::ignore_unused(bytes_transferred);
+                if (ec == http::error::end_of_stream)
+                    return self->close();
+                if (!ec)
+                    self->handleRequest();
+            }));
+    }
+
+    void handleRequest() {
+        Request &req = *req_;
+        Response &res = *res_;
+        res.version(req.version());
+        res.keep_alive(req.keep_alive());
+        encoding_ = negotiate(req[http::field::accept_encoding]);
+
+        std::string allow;
+        const Route *route = server_.routes.match(req.method(), req.target(), params_, &allow);
+        // HEAD without a route of its own runs the GET route; only the body
+        // is left out, Content-Length stays that of the GET response.
+        if (route == nullptr && req.method() == http::verb::head)
+            route = server_.routes.match(http::verb::get, req.target(), params_, &allow);
+
+        if (route == nullptr && allow.empty()) {
+            // For other requests, return 404 not found
+            return writeCached(server_.not_found.get(server_.compression));
+        } else if (route == nullptr) {
+            res.result(http::status::method_not_allowed);
+            res.set(http::field::allow, allow);
+            res.set(http::field::content_type, "text/plain");
+            res.body() = "405 Method Not Allowed\n";
+        } else if (route->dispatch == Dispatch::Cached) {
+            return writeCached(route->cache->get(server_.compression));
+        } else if (route->dispatch == Dispatch::Inline) {
+            route->handler(req, res, params_);
+            compressBody();
+        } else {
+            // No I/O is pending on this session while the job runs, so the
+            // pool thread has the messages and arena to itself until it posts back.
+            // Queue wait and handler time are recorded as a job named after
+            // the route, e.g. "GET /get/users".
+            Ptr self(this);
+            auto submitted = std::chrono::steady_clock::now();
+            bool queued = server_.blocking->trySubmit([self, route, submitted] {
+                auto start = std::chrono::steady_clock::now();
+                route->handler(*self->req_, *self->res_, self->params_);
+                route->metrics->recordRun(std::chrono::steady_clock::now() - start,
+                                          start - submitted);
+                // Compressing here keeps that CPU work off the I/O threads too.
+                self->compressBody();
+                net::post(self->stream_.get_executor(), [self] {
+                    self->res_->prepare_payload();
+                    self->writeResponse();
+                });
+            });
+            if (queued)
+                return;
+
+            res.result(http::status::service_unavailable);
+            res.set(http::field::content_type, "text/plain");
+            res.set(http::field::retry_after, "1");
+            res.body() = "503 Service Unavailable\n";
+            route->metrics->recordSkipped();
+        }
+
+        res.prepare_payload();
+        writeResponse();
+    }
+
+    // Compresses the response body for the negotiated coding, into the
+    // arena. Uses the calling thread's Deflater.
+    void compressBody() {
+        Response &res = *res_;
+        if (!worthCompressing(res, server_.compression))
+            return;
+        varyOnEncoding(res);
+        if (encoding_ == Encoding::Identity)
+            return;
+
+        Body::value_type out(res.body().get_allocator());
+        Deflater::forThread().compress(res.body().data(), res.body().size(), encoding_,
+                                       server_.compression.level, out);
+        if (out.size() >= res.body().size())
+            return;  // not compressible after all
+        res.body().swap(out);
+        res.set(http::field::content_encoding, toString(encoding_));
+    }
+
+    void writeResponse() {
+        Ptr self(this);
+        auto done = [self](beast::error_code ec, std::size_t) {
+            if (ec)
+                return;
+            if (self->res_->need_eof())
+                return self->close();
+            self->readRequest();
+        };
+
+        deadline_ = Clock::now() + kIdleTimeout;
+        if (req_->method() == http::verb::head) {
+            head_.emplace(*res_);
+            return http::async_write_header(stream_, *head_, recycled(std::move(done)));
+        }
+        http::async_write(stream_, *res_, recycled(std::move(done)));
+    }
+
+    // Writes a pre-serialized response straight from the shared cache: one
+    // gather write of the head and the body, no copies, no header map.
+    void writeCached(std::shared_ptr<const SerializedResponse> cached) {
+        Ptr self(this);
+        bool keep_alive = req_->keep_alive();
+        bool v11 = req_->version() >= 11;
+        const SerializedResponse::Variant &variant = cached->variant(encoding_);
+        bool not_modified = variant.matches((*req_)[http::field::if_none_match]);
+
+        // 304 replies and replies to HEAD carry no body; the second buffer
+        // is then empty.
+        std::array<net::const_buffer, 2> buffers;
+        if (not_modified) {
+            buffers[0] = net::buffer(variant.not_modified[v11][keep_alive]);
+        } else {
+            buffers[0] = net::buffer(variant.heads[v11][keep_alive]);
+            if (req_->method() != http::verb::head)
+                buffers[1] = net::buffer(variant.body);
+        }
+
+        deadline_ = Clock::now() + kIdleTimeout;
+        // cached owns the bytes, so it rides along until the write completes.
+        net::async_write(
+            stream_, buffers,
+            recycled([self, cached, keep_alive](beast::error_code ec, std::size_t) {
+                if (ec)
+                    return;
+                if (!keep_alive)
+                    return self->close();
+                self->readRequest();
+            }));
+    }
+
+    void close() {
+        beast::error_code ec;
+        stream_.socket().shutdown(tcp::socket::shutdown_send, ec);
+    }
+};
+
+// Finished sessions of one acceptor, ready for the next connection. All of
+// them share the acceptor's io_context.
+class SessionPool {
+  public:
+    SessionPool(net::io_context &ioc, ServerState &server, bool strand_per_session)
+        : ioc_(ioc), server_(server), strand_per_session_(strand_per_session) {}
+
+    ~SessionPool() { close(); }
+
+    HttpSession::Ptr acquire() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!idle_.empty()) {
+                HttpSession *session = idle_.back();
+                idle_.pop_back();
+                return HttpSession::Ptr(session);
+            }
+        }
+        net::any_io_executor executor = ioc_.get_executor();
+        if (strand_per_session_)
+            executor = net::make_strand(ioc_);
+        return HttpSession::Ptr(new HttpSession(std::move(executor), server_, *this));
+    }
+
+    void recycle(HttpSession *session) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (closed_) {
+                delete session;
+                return;
+            }
+        }
+        session->reset();
+        std::lock_guard<std::mutex> lock(mutex_);
+        idle_.push_back(session);
+    }
+
+    // Frees the idle sessions; sessions still in use are freed when they
+    // finish. Call while the io_context is still alive.
+    void close() {
+        std::vector<HttpSession *> idle;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+            idle.swap(idle_);
+        }
+        for (HttpSession *session : idle) {
+            delete session;
+        }
+    }
+
+  private:
+    net::io_context &ioc_;
+    ServerState &server_;
+    bool strand_per_session_;
+    std::mutex mutex_;
+    std::vector<HttpSession *> idle_;
+    bool closed_ = false;
+};
+
+inline void intrusive_ptr_release(HttpSession *session) {
+    if (session->refs_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        session->pool_.recycle(session);
+}
+
+enum class ServerMode {
+    // One io_context per thread, each with its own SO_REUSEPORT acceptor.
+    // The kernel spreads connections across them; sessions never hop threads.
+    ReusePort,
+    // One io_context run by every thread; each session gets its own strand.
+    SharedContext,
+};
+
+struct ServerOptions {
+    size_t threads = std::thread::hardware_concurrency();
+    ServerMode mode = ServerMode::ReusePort;
+    size_t blocking_threads = 4;  // BlockingPool size
+    size_t blocking_queue = 64;   // queued blocking requests before 503
+    CompressionOptions compression;  // gzip/deflate by Accept-Encoding
+};
+
+class HttpServer {
+  public:
+    using Mode = ServerMode;
+
+    HttpServer(int port, size_t threads, Mode mode = Mode::ReusePort)
+        : HttpServer(port, ServerOptions{threads, mode}) {}
+
+    explicit HttpServer(int port, ServerOptions options = ServerOptions())
+        : mode_(options.mode) {
+        size_t threads = std::max<size_t>(options.threads, 1);
+        size_t contexts = (mode_ == Mode::ReusePort) ? threads : 1;
+        for (size_t i = 0; i < contexts; ++i) {
+            contexts_.push_back(std::make_unique<net::io_context>(
+                mode_ == Mode::ReusePort ? 1 : static_cast<int>(threads)));
+        }
+        threads_ = threads;
+
+        auto bind_port = static_cast<unsigned short>(port);
+        for (auto &ioc : contexts_) {
+            acceptors_.push_back(std::make_unique<tcp::acceptor>(*ioc));
+            tcp::acceptor &acceptor = *acceptors_.back();
+            acceptor.open(tcp::v4());
+            acceptor.set_option(net::socket_base::reuse_address(true));
+            if (mode_ == Mode::ReusePort) {
+                acceptor.set_option(reuse_port(true));
+            }
+            acceptor.bind({tcp::v4(), bind_port});
+            acceptor.listen(net::socket_base::max_listen_connections);
+            // With port 0 the first bind picks a port; the rest share it.
+            bind_port = acceptor.local_endpoint().port();
+        }
+        state_.blocking = std::make_unique<BlockingPool>(options.blocking_threads,
+                                                         options.blocking_queue);
+        state_.compression = options.compression;
+        for (auto &ioc : contexts_) {
+            pools_.push_back(
+                std::make_unique<SessionPool>(*ioc, state_, mode_ == Mode::SharedContext));
+        }
+        for (size_t i = 0; i < acceptors_.size(); ++i) {
+            accept(i);
+        }
+    }
+
+    ~HttpServer() {
+        // Idle sessions own sockets of contexts_, so they go first.
+        for (auto &pool : pools_) {
+            pool->close();
+        }
+    }
+
+    // Registers a handler for a method and path pattern such as
+    // "/users/{id}". Call before run(). Throws std::invalid_argument for bad
+    // or duplicate patterns, and for Cached routes with parameters.
+    void route(http::verb method, std::string path, Handler handler,
+               Dispatch dispatch = Dispatch::Inline) {
+        std::shared_ptr<ResponseCache> cache;
+        if (dispatch == Dispatch::Cached) {
+            if (path.find('{') != std::string::npos)
+                throw std::invalid_argument("cached route with parameters: " + path);
+            cache = std::make_shared<ResponseCache>(handler);
+        }
+        std::shared_ptr<JobMetrics> metrics;
+        if (dispatch == Dispatch::Blocking) {
+            std::string name(http::to_string(method));
+            metrics = std::make_shared<JobMetrics>(
+                JobMetricsRegistry::global().add(name + " " + path));
+        }
+        std::string pattern = path;
+        state_.routes.add(method, pattern,
+                          Route{method, std::move(path), std::move(handler), dispatch,
+                                std::move(cache), std::move(metrics)});
+    }
+
+    void route(http::verb method, std::string path, SimpleHandler handler,
+               Dispatch dispatch = Dispatch::Inline) {
+        route(method, std::move(path),
+              Handler([handler = std::move(handler)](const Request &req, Response &res,
+                                                     const PathParams &) { handler(req, res); }),
+              dispatch);
+    }
+
+    // Serves JobMetricsRegistry::global() in the Prometheus text format:
+    // blocking routes of this server plus any other job in the process.
+    void serveMetrics(std::string path = "/metrics") {
+        route(http::verb::get, std::move(path), [](const Request &, Response &res) {
+            res.result(http::status::ok);
+            res.set(http::field::content_type, "text/plain; version=0.0.4");
+            std::string text = JobMetricsRegistry::global().prometheus();
+            res.body().assign(text.data(), text.size());
+        });
+    }
+
+    // Drops the cached response of a Dispatch::Cached route, e.g. after the
+    // data behind it changed. Safe to call from any thread.
+    bool invalidate(http::verb method, beast::string_view path) {
+        PathParams params;
+        const Route *route = state_.routes.match(method, path, params);
+        if (route == nullptr || !route->cache)
+            return false;
+        route->cache->invalidate();
+        return true;
+    }
+
+    unsigned short port() const { return acceptors_.front()->local_endpoint().port(); }
+
+    // Runs the server on threads_ threads (including the caller) until stop().
+    void run() {
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < threads_; ++i) {
+            workers.emplace_back([this, i] { context(i).run(); });
+        }
+        context(0).run();
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    }
+
+    void stop() {
+        for (auto &ioc : contexts_) {
+            ioc->stop();
+        }
+    }
+
+  private:
+    using reuse_port = net::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+
+    Mode mode_;
+    size_t threads_;
+    // Declared before contexts_: sessions still referenced by pending
+    // handlers return to their pool while the io_contexts are destroyed.
+    std::vector<std::unique_ptr<SessionPool>> pools_;
+    std::vector<std::unique_ptr<net::io_context>> contexts_;
+    std::vector<std::unique_ptr<tcp::acceptor>> acceptors_;
+    // Declared after contexts_ so the blocking pool's threads are joined
+    // before the io_contexts they post completions to are destroyed.
+    ServerState state_;
+
+    net::io_context &context(size_t thread) { return *contexts_[thread % contexts_.size()]; }
+
+    // Accepts straight into a pooled session's socket, so the session keeps
+    // its executor (and strand) across connections.
+    void accept(size_t i) {
+        HttpSession::Ptr session = pools_[i]->acquire();
+        tcp::socket &socket = session->socket();
+        acceptors_[i]->async_accept(socket, [this, i, session](beast::error_code ec) {
+            // The accept handler runs on the acceptor's executor; start the
+            // session on its own, like all its later handlers.
+            if (!ec)
+                net::dispatch(session->executor(), [session] { session->run(); });
+
+            accept(i);
+        });
+    }
+};
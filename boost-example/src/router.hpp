@@ -0,0 +1,297 @@
+#pragma once
+
+#include <array>
+#include <boost/beast/core/string.hpp>
+#include <boost/beast/http/verb.hpp>
+#include <cstdint>
+#include <deque>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Values captured from `{name}` segments of a route pattern. Both name and
+// value are views: the name into the router, the value into the request
+// target, so they are only valid while that request is.
+class PathParams {
+  public:
+    static constexpr size_t kMaxParams = 8;
+
+    // Returns an empty view when the pattern has no such parameter.
+    boost::beast::string_view get(boost::beast::string_view name) const {
+        for (size_t i = 0; i < count_; ++i) {
+            if (items_[i].first == name)
+                return items_[i].second;
+        }
+        return {};
+    }
+
+    size_t size() const { return count_; }
+    const std::pair<boost::beast::string_view, boost::beast::string_view> &
+    operator[](size_t i) const {
+        return items_[i];
+    }
+
+    void clear() { count_ = 0; }
+
+  private:
+    template <typename T>
+    friend class RadixRouter;
+
+    std::array<std::pair<boost::beast::string_view, boost::beast::string_view>, kMaxParams>
+        items_;
+    size_t count_ = 0;
+};
+
+// Compressed radix tree from (method, path pattern) to T.
+//
+// Patterns are literal paths where a whole segment may be a parameter:
+// "/users/{id}/posts". Edges hold the longest literal run shared by their
+// routes, so a lookup compares each target byte about once. A literal
+// segment wins over a parameter at the same position; if the literal
+// branch fails further down, or ends at a node without a route for the
+// request's method, the parameter branch is tried.
+//
+// Routes are added at startup; match() is then read-only, never allocates
+// and may be called from any number of threads. Values keep their address
+// for the router's lifetime.
+template <typename T>
+class RadixRouter {
+    using string_view = boost::beast::string_view;
+    using verb = boost::beast::http::verb;
+
+  public:
+    RadixRouter() { nodes_.emplace_back(); }
+
+    // Throws std::invalid_argument for malformed patterns and for a method
+    // and pattern that are already registered.
+    T &add(verb method, string_view pattern, T value) {
+        if (pattern.empty() || pattern.front() != '/')
+            throw std::invalid_argument("route must start with '/': " + std::string(pattern));
+        if (paramCount(pattern) > PathParams::kMaxParams)
+            throw std::invalid_argument("too many path parameters: " + std::string(pattern));
+
+        uint32_t node = insert(pattern);
+        for (auto &entry : nodes_[node].methods) {
+            if (entry.first == method)
+                throw std::invalid_argument("duplicate route: " + std::string(pattern));
+        }
+        values_.push_back(std::move(value));
+        nodes_[node].methods.emplace_back(method, static_cast<uint32_t>(values_.size() - 1));
+        return values_.back();
+    }
+
+    // Looks up the route for a request target; a query string is ignored.
+    // If no branch has a route for this method but some have one for the
+    // path, returns nullptr and, when `allow` is given, fills it with the
+    // methods of all of them.
+    const T *match(verb method, string_view target, PathParams &params,
+                   std::string *allow = nullptr) const {
+        string_view path = target.substr(0, target.find('?'));
+        params.clear();
+        uint32_t value = find(0, path, method, params);
+        if (value != kNone)
+            return &values_[value];
+        params.clear();
+        if (allow != nullptr) {
+            allow->clear();
+            allowed(0, path, *allow);
+        }
+        return nullptr;
+    }
+
+    size_t size() const { return values_.size(); }
+
+    // Visits every registered value, in registration order.
+    template <typename F>
+    void forEach(F &&f) {
+        for (T &value : values_) {
+            f(value);
+        }
+    }
+
+  private:
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    struct Node {
+        std::string prefix;              // literal edge label from the parent
+        std::string param_name;          // set on nodes reached through {param}
+        std::string first;               // first byte of each literal child's prefix
+        std::vector<uint32_t> children;  // literal children, parallel to first
+        uint32_t param = kNone;          // child matching one {param} segment
+        std::vector<std::pair<verb, uint32_t>> methods;  // routes ending here
+    };
+
+    static size_t paramCount(string_view pattern) {
+        size_t count = 0;
+        for (char c : pattern) {
+            count += (c == '{');
+        }
+        return count;
+    }
+
+    // Walks or extends the tree along the pattern and returns the node where
+    // it ends. Indices are used throughout since nodes_ may reallocate.
+    uint32_t insert(string_view pattern) {
+        uint32_t node = 0;
+        string_view rest = pattern;
+        while (!rest.empty()) {
+            if (rest.front() == '{') {
+                size_t close = rest.find('}');
+                if (close == string_view::npos || close == 1 ||
+                    (close + 1 < rest.size() && rest[close + 1] != '/') ||
+                    nodes_[node].prefix.empty() || nodes_[node].prefix.back() != '/')
+                    throw std::invalid_argument("parameter must be a whole segment: " +
+                                                std::string(pattern));
+                string_view name = rest.substr(1, close - 1);
+                if (nodes_[node].param == kNone) {
+                    uint32_t child = newNode();
+                    nodes_[child].param_name = std::string(name);
+                    nodes_[node].param = child;
+                } else if (nodes_[nodes_[node].param].param_name != name) {
+                    throw std::invalid_argument("conflicting parameter name: " +
+                                                std::string(pattern));
+                }
+                node = nodes_[node].param;
+                rest.remove_prefix(close + 1);
+                continue;
+            }
+
+            string_view literal = rest.substr(0, rest.find('{'));
+            size_t slot = nodes_[node].first.find(literal.front());
+            if (slot == std::string::npos) {
+                uint32_t child = newNode();
+                nodes_[child].prefix = std::string(literal);
+                nodes_[node].first.push_back(literal.front());
+                nodes_[node].children.push_back(child);
+                node = child;
+                rest.remove_prefix(literal.size());
+                continue;
+            }
+
+            uint32_t child = nodes_[node].children[slot];
+            const std::string &prefix = nodes_[child].prefix;
+            size_t common = 0;
+            while (common < prefix.size() && common < literal.size() &&
+                   prefix[common] == literal[common]) {
+                ++common;
+            }
+            if (common < prefix.size())
+                split(child, common);
+            node = child;
+            rest.remove_prefix(common);
+        }
+        return node;
+    }
+
+    // Cuts node's edge after `at` bytes: the node keeps the head, a new child
+    // takes the tail together with everything that hung below the node.
+    void split(uint32_t node, size_t at) {
+        uint32_t tail = newNode();
+        Node &n = nodes_[node];
+        Node &t = nodes_[tail];
+        t.prefix = n.prefix.substr(at);
+        t.first = std::move(n.first);
+        t.children = std::move(n.children);
+        t.param = n.param;
+        t.methods = std::move(n.methods);
+
+        n.prefix.resize(at);
+        n.first.assign(1, t.prefix.front());
+        n.children.assign(1, tail);
+        n.param = kNone;
+        n.methods.clear();
+    }
+
+    uint32_t newNode() {
+        nodes_.emplace_back();
+        return static_cast<uint32_t>(nodes_.size() - 1);
+    }
+
+    // `path` is what is left after the node's own label was matched.
+    // Returns the index in values_ of the route for `method` where the whole
+    // path ends, or kNone. A node without that method counts as a miss, so
+    // the parameter branch still gets its turn.
+    uint32_t find(uint32_t node, string_view path, verb method, PathParams &params) const {
+        const Node &n = nodes_[node];
+        if (path.empty()) {
+            for (auto &entry : n.methods) {
+                if (entry.first == method)
+                    return entry.second;
+            }
+            return kNone;
+        }
+
+        size_t slot = n.first.find(path.front());
+        if (slot != std::string::npos) {
+            uint32_t child = n.children[slot];
+            const std::string &prefix = nodes_[child].prefix;
+            if (path.size() >= prefix.size() &&
+                path.compare(0, prefix.size(), prefix) == 0) {
+                uint32_t found = find(child, path.substr(prefix.size()), method, params);
+                if (found != kNone)
+                    return found;
+            }
+        }
+
+        if (n.param != kNone) {
+            size_t end = std::min(path.find('/'), path.size());
+            if (end == 0)
+                return kNone;
+            size_t saved = params.count_;
+            params.items_[params.count_++] = {nodes_[n.param].param_name, path.substr(0, end)};
+            uint32_t found = find(n.param, path.substr(end), method, params);
+            if (found != kNone)
+                return found;
+            params.count_ = saved;
+        }
+        return kNone;
+    }
+
+    // Appends the methods of every node, on any branch, where the whole path
+    // ends. Only used to answer 405, so it need not be fast.
+    void allowed(uint32_t node, string_view path, std::string &allow) const {
+        const Node &n = nodes_[node];
+        if (path.empty()) {
+            for (auto &entry : n.methods) {
+                string_view name = boost::beast::http::to_string(entry.first);
+                if (!listed(allow, name)) {
+                    if (!allow.empty())
+                        allow.append(", ");
+                    allow.append(name.data(), name.size());
+                }
+            }
+            return;
+        }
+
+        size_t slot = n.first.find(path.front());
+        if (slot != std::string::npos) {
+            uint32_t child = n.children[slot];
+            const std::string &prefix = nodes_[child].prefix;
+            if (path.size() >= prefix.size() && path.compare(0, prefix.size(), prefix) == 0)
+                allowed(child, path.substr(prefix.size()), allow);
+        }
+
+        if (n.param != kNone) {
+            size_t end = std::min(path.find('/'), path.size());
+            if (end != 0)
+                allowed(n.param, path.substr(end), allow);
+        }
+    }
+
+    // Whether `name` is one of the comma separated entries of `list`.
+    static bool listed(string_view list, string_view name) {
+        while (!list.empty()) {
+            size_t comma = list.find(',');
+            if (list.substr(0, comma) == name)
+                return true;
+            if (comma == string_view::npos)
+                break;
+            list.remove_prefix(comma + 2);
+        }
+        return false;
+    }
+
+    std::vector<Node> nodes_;  // nodes_[0] is the root, matching ""
+    std::deque<T> values_;
+};
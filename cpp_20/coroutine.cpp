@@ -1,66 +1,402 @@
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
 #include <coroutine> // 코루틴을 사용하기 위한 헤더
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
 #include <iostream>
+#include <memory>
+#include <netinet/in.h>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
 
-// 지금은 비어 있지만 앞으로 완성 되어져갈 코루틴 반환 객체
-class Task {
-  public:
-    // 규칙 1. C++에서 정의된 규칙을 구현한 promise_type 이라는 이름의 타입이
-    // 정의되어야 한다.
-    struct promise_type {
-        // 사용자 정의 "코루틴 반환 객체"를 반환 한다
-        Task get_return_object() {
-            return Task{
-                std::coroutine_handle<promise_type>::from_promise(*this)};
-        }
+#include "io_context.hpp" // IoContext: read_at/write_at/accept/recv/send
+#include "task.hpp"       // Task<T>, Scheduler, when_all/when_any
 
-        // 코루틴 최초 실행 시 호출. awaitable 객체를 반환 한다.
-        auto initial_suspend() { return std::suspend_always{}; }
+using namespace std::chrono_literals;
 
-        // co_return을 사용하는 경우 구현. 나중에 코루틴 종료를 설명 할 때 같이
-        // 설명
-        auto return_void() { return std::suspend_never{}; }
+// 코루틴 함수
+//     규칙 1. co_await 또는 co_return 을 사용한다
+//     규칙 2. 코루틴 반환 객체(Task<T>)를 리턴한다
+// Task 는 co_await 될 때 시작하고, co_return 한 값이 co_await 의 결과가 된다.
+Task<int> answer() { co_return 42; }
 
-        // 코루틴 종료 시 호출. 나중에 코루틴 종료를 설명 할 때 같이 설명
-        auto final_suspend() noexcept(true) { return std::suspend_always{}; }
+Task<std::string> foo() {
+    std::cout << "foo 1" << std::endl;
+    int v = co_await answer(); // answer() 가 끝나면 중단 없이 여기서 이어진다
+    std::cout << "foo 2" << std::endl;
+    co_return "answer is " + std::to_string(v);
+}
 
-        // 코루틴 수행 중 예외 발생 시 호출
-        void unhandled_exception() { std::exit(1); }
-    };
+// 동기적으로 끝나는 Task 를 아주 많이 연달아 co_await 한다.
+// 끝날 때마다 resume() 이 중첩된다면 여기서 스택이 넘친다. (-O0, sanitizer 빌드 포함)
+Task<int> one() { co_return 1; }
+
+Task<long> sumOnes(int n) {
+    long sum = 0;
+    for (int i = 0; i < n; ++i) {
+        sum += co_await one();
+    }
+    co_return sum;
+}
+
+// 풀로 넘어가서 잠깐 기다렸다가 값을 돌려 준다. 기다리는 동안 스레드를 쓰지 않는다.
+Task<int> delayed(Scheduler &scheduler, int value, std::chrono::milliseconds delay) {
+    co_await scheduler.schedule();
+    co_await scheduler.sleep_for(delay);
+    co_return value;
+}
 
-    // 규칙 2. std::coroutine_handle<promise_type> 타입의 멤버 변수가 있어야
-    // 한다.
-    std::coroutine_handle<promise_type> co_handler;
+Task<void> fails(Scheduler &scheduler) {
+    co_await scheduler.schedule();
+    throw std::runtime_error("boom");
+}
+
+// spawn() 으로 띄우는 작업. 결과를 기다리는 쪽이 없다.
+Task<void> background(Scheduler &scheduler) {
+    co_await scheduler.sleep_for(10ms);
+    std::cout << "background task done" << std::endl;
+}
 
-    // 규칙 3. std::coroutine_handle<promise_type> 을 인자로 받아
-    // 멤버 변수를 초기화 하는 생성자가 있어야 한다.
-    Task(std::coroutine_handle<promise_type> handler) : co_handler(handler) {}
+// waits 개의 코루틴이 동시에 1~100ms 씩 기다린다.
+Task<long> manyWaits(Scheduler &scheduler, int waits) {
+    std::vector<Task<int>> tasks;
+    tasks.reserve(waits);
+    for (int i = 0; i < waits; ++i) {
+        tasks.push_back(delayed(scheduler, 1, std::chrono::milliseconds(1 + i % 100)));
+    }
+    std::vector<int> results = co_await when_all(std::move(tasks));
+    long sum = 0;
+    for (int v : results) {
+        sum += v;
+    }
+    co_return sum;
+}
+
+// 프레임 할당 벤치마크용 코루틴. 둘 다 같은 일을 하고 프레임 할당만 다르다.
+//  - pooled : FramePool (기본)
+//  - global : std::allocator, 즉 전역 operator new/delete
+Task<int> pooled(int x) { co_return x + 1; }
+
+Task<int> global(std::allocator_arg_t, std::allocator<std::byte>, int x) { co_return x + 1; }
+
+template <typename Make>
+Task<long> frameLoop(int n, Make make) {
+    long sum = 0;
+    for (int i = 0; i < n; ++i) {
+        sum += co_await make(i);
+    }
+    co_return sum;
+}
 
-    // 규칙 4. 소멸자에서 std::coroutine_handle<promise_type> 타입의
-    // 코루틴 핸들러 멤버 변수의 destroy를 호출 해야 한다.
-    ~Task() {
-        if (true == (bool)co_handler) {
-            co_handler.destroy();
+// 여러 스레드에서 만들어지고 다른 스레드에서 해제되는 프레임
+template <typename Make>
+Task<long> frameFanOut(Scheduler &scheduler, int n, Make make) {
+    constexpr int kBatch = 1000;
+    long sum = 0;
+    for (int i = 0; i < n; i += kBatch) {
+        std::vector<Task<int>> tasks;
+        tasks.reserve(kBatch);
+        for (int j = 0; j < kBatch; ++j) {
+            tasks.push_back(make(scheduler, i + j));
         }
+        for (int v : co_await when_all(std::move(tasks))) {
+            sum += v;
+        }
+    }
+    co_return sum;
+}
+
+Task<int> pooledOnPool(Scheduler &scheduler, int x) {
+    co_await scheduler.schedule();
+    co_return x + 1;
+}
+
+Task<int> globalOnPool(std::allocator_arg_t, std::allocator<std::byte>, Scheduler &scheduler,
+                       int x) {
+    co_await scheduler.schedule();
+    co_return x + 1;
+}
+
+template <typename Run>
+void benchFrames(const char *name, int n, Run run) {
+    auto start = std::chrono::steady_clock::now();
+    long sum = run();
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << name << ": " << static_cast<long>(n / s / 1e6 * 10) / 10.0 << " M frames/s"
+              << " (sum " << sum << ")" << std::endl;
+}
+
+int benchFrameAllocation(int n) {
+    std::allocator<std::byte> alloc;
+    for (int round = 0; round < 2; ++round) {
+        benchFrames("sequential pooled", n,
+                    [&] { return sync_wait(frameLoop(n, [](int i) { return pooled(i); })); });
+        benchFrames("sequential global", n, [&] {
+            return sync_wait(
+                frameLoop(n, [&](int i) { return global(std::allocator_arg, alloc, i); }));
+        });
+    }
+
+    Scheduler scheduler(4);
+    int m = n / 10;
+    for (int round = 0; round < 2; ++round) {
+        benchFrames("scheduled pooled ", m, [&] {
+            return sync_wait(frameFanOut(scheduler, m, [](Scheduler &s, int i) {
+                return pooledOnPool(s, i);
+            }));
+        });
+        benchFrames("scheduled global ", m, [&] {
+            return sync_wait(frameFanOut(scheduler, m, [&](Scheduler &s, int i) {
+                return globalOnPool(std::allocator_arg, alloc, s, i);
+            }));
+        });
+    }
+    return 0;
+}
+
+// ---- I/O ----
+
+// 루프백 에코: 서버는 accept -> recv -> send, 클라이언트는 send -> recv
+Task<std::string> echoServer(IoContext &io, int listener) {
+    int conn = co_await io.accept(listener);
+    if (conn < 0) {
+        co_return "accept: " + std::string(strerror(-conn));
+    }
+    char buf[64];
+    int n = co_await io.recv(conn, buf, sizeof(buf));
+    if (n > 0) {
+        n = co_await io.send(conn, buf, static_cast<size_t>(n));
+    }
+    close(conn);
+    co_return n < 0 ? "server: " + std::string(strerror(-n)) : "ok";
+}
+
+Task<std::string> echoClient(IoContext &io, int sock) {
+    const char message[] = "hello io";
+    int n = co_await io.send(sock, message, sizeof(message) - 1);
+    char buf[64] = {};
+    if (n > 0) {
+        n = co_await io.recv(sock, buf, sizeof(buf) - 1);
+    }
+    co_return n < 0 ? "client: " + std::string(strerror(-n)) : std::string(buf, static_cast<size_t>(n));
+}
+
+void echoDemo(IoContext::Backend backend) {
+    IoContext io(64, backend);
+    int listener = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (bind(listener, reinterpret_cast<sockaddr *>(&addr), len) < 0 || listen(listener, 8) < 0 ||
+        getsockname(listener, reinterpret_cast<sockaddr *>(&addr), &len) < 0) {
+        std::cerr << "listen failed: " << strerror(errno) << std::endl;
+        close(listener);
+        return;
+    }
+    // 루프백 connect 는 accept 전에 backlog 에서 끝나므로 블로킹으로 해도 된다.
+    int sock = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (connect(sock, reinterpret_cast<sockaddr *>(&addr), len) < 0) {
+        std::cerr << "connect failed: " << strerror(errno) << std::endl;
+    } else {
+        auto [server, client] = io.run(when_all(echoServer(io, listener), echoClient(io, sock)));
+        std::cout << "echo over " << io.backend() << ": server " << server << ", client got \""
+                  << client << "\"" << std::endl;
     }
+    close(sock);
+    close(listener);
+}
+
+// 파일 하나에서 4 KiB 씩 임의 위치를 읽는 벤치마크
+struct IoBench {
+    static constexpr size_t kBlock = 4096;
+    static constexpr size_t kFileSize = 256 << 20;
+
+    int fd = -1;
+    std::vector<off_t> offsets;
+    std::atomic<size_t> next{0};
+    size_t failures = 0;
 };
 
-// 코루틴 함수
-//     규칙 2. co_await를 사용한다
-//     규칙 3. 코루틴 반환 객체(Task)를 리턴한다
-Task foo() {
-    std::cout << "foo 1" << std::endl;
-    co_await std::suspend_always{};
-    std::cout << "foo 2" << std::endl;
+Task<void> benchReader(IoContext &io, IoBench &bench, std::byte *buf, int buf_index) {
+    for (size_t i = bench.next++; i < bench.offsets.size(); i = bench.next++) {
+        int n = buf_index < 0 ? co_await io.read_at(bench.fd, buf, IoBench::kBlock, bench.offsets[i])
+                              : co_await io.read_fixed(bench.fd, buf, IoBench::kBlock,
+                                                       bench.offsets[i], buf_index);
+        bench.failures += n != static_cast<int>(IoBench::kBlock);
+    }
+}
+
+template <typename Run>
+void benchIo(const char *name, IoBench &bench, Run run) {
+    bench.next = 0;
+    bench.failures = 0;
+    auto start = std::chrono::steady_clock::now();
+    run();
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << name << ": " << static_cast<long>(bench.offsets.size() / s) << " reads/s";
+    if (bench.failures != 0) {
+        std::cout << " (" << bench.failures << " failed)";
+    }
+    std::cout << std::endl;
+}
+
+// main --bench-io [reads] [depth] [--buffered]
+// 기본은 O_DIRECT 로 디스크까지 간다. --buffered 면 페이지 캐시에서 읽는다.
+int benchFileReads(size_t reads, size_t depth, bool buffered) {
+    const char *path = "cpp20_io_bench.dat";
+    IoBench bench;
+    {
+        int out = open(path, O_CREAT | O_WRONLY | O_CLOEXEC, 0644);
+        struct stat st;
+        if (out < 0 || fstat(out, &st) < 0) {
+            std::cerr << "Error creating " << path << ": " << strerror(errno) << std::endl;
+            return 1;
+        }
+        if (static_cast<size_t>(st.st_size) < IoBench::kFileSize) {
+            std::vector<char> chunk(1 << 20, 'x');
+            for (size_t off = 0; off < IoBench::kFileSize; off += chunk.size()) {
+                if (pwrite(out, chunk.data(), chunk.size(), static_cast<off_t>(off)) < 0) {
+                    std::cerr << "Error writing " << path << ": " << strerror(errno) << std::endl;
+                    close(out);
+                    return 1;
+                }
+            }
+            fsync(out);
+        }
+        close(out);
+    }
+    bench.fd = open(path, O_RDONLY | O_CLOEXEC | (buffered ? 0 : O_DIRECT));
+    if (bench.fd < 0) {
+        std::cerr << "Error opening " << path << ": " << strerror(errno) << std::endl;
+        return 1;
+    }
+    std::mt19937_64 rng(42);
+    std::uniform_int_distribution<size_t> pick(0, IoBench::kFileSize / IoBench::kBlock - 1);
+    for (size_t i = 0; i < reads; ++i) {
+        bench.offsets.push_back(static_cast<off_t>(pick(rng) * IoBench::kBlock));
+    }
+
+    // O_DIRECT 는 정렬된 버퍼가 필요하다. 코루틴마다 4 KiB 씩.
+    size_t bytes = depth * IoBench::kBlock;
+    auto *arena = static_cast<std::byte *>(std::aligned_alloc(IoBench::kBlock, bytes));
+    std::cout << reads << " random " << IoBench::kBlock << "-byte reads, "
+              << (buffered ? "buffered" : "O_DIRECT") << ", depth " << depth << std::endl;
+
+    benchIo("blocking pread, 1 thread      ", bench, [&] {
+        for (off_t off : bench.offsets) {
+            bench.failures += pread(bench.fd, arena, IoBench::kBlock, off) !=
+                              static_cast<ssize_t>(IoBench::kBlock);
+        }
+    });
+    benchIo("blocking pread, thread per op ", bench, [&] {
+        std::vector<std::thread> threads;
+        std::atomic<size_t> failures{0};
+        for (size_t t = 0; t < depth; ++t) {
+            threads.emplace_back([&, t] {
+                std::byte *buf = arena + t * IoBench::kBlock;
+                for (size_t i = bench.next++; i < bench.offsets.size(); i = bench.next++) {
+                    failures += pread(bench.fd, buf, IoBench::kBlock, bench.offsets[i]) !=
+                                static_cast<ssize_t>(IoBench::kBlock);
+                }
+            });
+        }
+        for (std::thread &t : threads) {
+            t.join();
+        }
+        bench.failures = failures;
+    });
+
+    auto coroutines = [&](IoContext &io, bool fixed) {
+        std::vector<Task<void>> readers;
+        for (size_t t = 0; t < depth; ++t) {
+            readers.push_back(benchReader(io, bench, arena + t * IoBench::kBlock, fixed ? 0 : -1));
+        }
+        io.run(when_all(std::move(readers)));
+    };
+    {
+        IoContext io(static_cast<unsigned>(depth));
+        benchIo("io_uring read_at              ", bench, [&] { coroutines(io, false); });
+        iovec region{arena, bytes};
+        if (io.registerBuffers({&region, 1})) {
+            benchIo("io_uring read_fixed           ", bench, [&] { coroutines(io, true); });
+        }
+    }
+    {
+        IoContext io(static_cast<unsigned>(depth), IoContext::Backend::Epoll);
+        benchIo("epoll fallback (blocking pread)", bench, [&] { coroutines(io, false); });
+    }
+
+    std::free(arena);
+    close(bench.fd);
+    unlink(path);
+    return 0;
 }
 
-int main() {
-    // 코루틴 foo()를 실행하면 본문 실행 전에 중단하고 호출자(main)에게 제어권
-    // 넘김 최초 중단시 코루틴 반환 객체(Task)를 호출자에게 돌려 준다
-    Task task = foo();
+int main(int argc, char *argv[]) {
+    // main --bench-frames [N] : 코루틴 프레임 할당 비교
+    if (argc > 1 && std::strcmp(argv[1], "--bench-frames") == 0) {
+        return benchFrameAllocation(argc > 2 ? std::atoi(argv[2]) : 20000000);
+    }
+    if (argc > 1 && std::strcmp(argv[1], "--bench-io") == 0) {
+        size_t reads = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 20000;
+        size_t depth = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 64;
+        bool buffered = argc > 4 && std::strcmp(argv[4], "--buffered") == 0;
+        return benchFileReads(reads, depth == 0 ? 1 : depth, buffered);
+    }
+
+    int waits = argc > 1 ? std::atoi(argv[1]) : 100000;
+    int chain = argc > 2 ? std::atoi(argv[2]) : 10000000;
+
+    // 코루틴 foo()를 실행하면 본문 실행 전에 중단하고 코루틴 반환 객체(Task)를
+    // 돌려 준다. sync_wait 은 foo() 가 끝날 때까지 main 스레드를 막는다.
+    Task<std::string> task = foo();
     std::cout << "\t main 1" << std::endl;
+    std::string text = sync_wait(std::move(task));
+    std::cout << "\t main 2: " << text << std::endl;
+
+    std::cout << "sumOnes(" << chain << ") = " << sync_wait(sumOnes(chain)) << std::endl;
+
+    Scheduler scheduler(4);
+    scheduler.spawn(background(scheduler));
+
+    auto [a, b, c] = sync_wait(when_all(delayed(scheduler, 1, 30ms), delayed(scheduler, 2, 10ms),
+                                        delayed(scheduler, 3, 20ms)));
+    std::cout << "when_all: " << a << " " << b << " " << c << std::endl;
+
+    std::vector<Task<int>> race;
+    race.push_back(delayed(scheduler, 1, 50ms));
+    race.push_back(delayed(scheduler, 2, 5ms));
+    race.push_back(delayed(scheduler, 3, 20ms));
+    auto [index, value] = sync_wait(when_any(std::move(race)));
+    std::cout << "when_any: task " << index << " won with " << value << std::endl;
 
-    // 코루틴 반환 객체의 멤버 coroutine_handle.resume()을 이용해 코루틴 재개
-    task.co_handler.resume();
-    std::cout << "\t main 2" << std::endl;
-    task.co_handler.resume();
-}
\ No newline at end of file
+    try {
+        sync_wait(fails(scheduler));
+    } catch (const std::exception &e) {
+        std::cout << "exception from task: " << e.what() << std::endl;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    long sum = sync_wait(manyWaits(scheduler, waits));
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                  std::chrono::steady_clock::now() - start)
+                  .count();
+    std::cout << sum << " concurrent waits on " << scheduler.threads() << " threads: " << ms
+              << " ms" << std::endl;
+
+    echoDemo(IoContext::Backend::Auto);
+    echoDemo(IoContext::Backend::Epoll);
+
+    // when_any 에서 진 Task 들이 끝나도록 잠시 기다린 뒤 풀을 닫는다.
+    sync_wait(delayed(scheduler, 0, 60ms));
+    return 0;
+}
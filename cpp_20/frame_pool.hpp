@@ -0,0 +1,214 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+
+// FramePool 클래스 정의
+// 코루틴 프레임용 크기별(size class) 메모리 풀입니다.
+//  - 64 바이트 단위 16 개 클래스(최대 1 KiB). 더 큰 프레임은 ::operator new 로 넘깁니다.
+//  - 스레드마다 클래스별 free list 를 두어 할당/해제에 잠금이 없습니다.
+//  - 프레임은 다른 스레드에서 해제되는 일이 많으므로(스케줄러) 한 스레드의 목록이
+//    kMaxCached 를 넘으면 절반을 공용 목록으로 옮기고, 비면 공용 목록에서 한 묶음
+//    가져옵니다. 공용 목록만 뮤텍스로 보호합니다.
+//  - 스레드가 끝나면 그 스레드의 목록은 공용 목록으로 돌아갑니다.
+class FramePool {
+public:
+    static constexpr size_t kGranule = 64;
+    static constexpr size_t kClasses = 16;
+    static constexpr size_t kMaxSize = kGranule * kClasses;
+
+    static void *allocate(size_t size) {
+        if (size > kMaxSize) {
+            return ::operator new(size);
+        }
+        Cache &cache = local();
+        size_t c = sizeClass(size);
+        Block *b = cache.lists[c].pop();
+        if (b == nullptr) {
+            b = cache.refill(c);
+        }
+        return b;
+    }
+
+    static void deallocate(void *p, size_t size) noexcept {
+        if (size > kMaxSize) {
+            ::operator delete(p, size);
+            return;
+        }
+        Cache &cache = local();
+        size_t c = sizeClass(size);
+        cache.lists[c].push(static_cast<Block *>(p));
+        if (cache.lists[c].count > kMaxCached) {
+            cache.spill(c);
+        }
+    }
+
+private:
+    static constexpr size_t kMaxCached = 256; // 스레드당 클래스별 최대 보관 수
+    static constexpr size_t kBatch = kMaxCached / 2;
+
+    struct Block {
+        Block *next;
+    };
+
+    struct List {
+        Block *head = nullptr;
+        size_t count = 0;
+
+        Block *pop() noexcept {
+            Block *b = head;
+            if (b != nullptr) {
+                head = b->next;
+                --count;
+            }
+            return b;
+        }
+
+        void push(Block *b) noexcept {
+            b->next = head;
+            head = b;
+            ++count;
+        }
+
+        // 앞에서 n 개를 떼어 낸 목록
+        List take(size_t n) noexcept {
+            List out;
+            while (out.count < n && head != nullptr) {
+                out.push(pop());
+            }
+            return out;
+        }
+
+        void splice(List &other) noexcept {
+            while (other.head != nullptr) {
+                push(other.pop());
+            }
+        }
+    };
+
+    // 공용 목록. 프로그램이 끝날 때 남은 블록을 돌려 줍니다.
+    struct Central {
+        std::mutex mutex;
+        List lists[kClasses];
+
+        ~Central() {
+            for (size_t c = 0; c < kClasses; ++c) {
+                while (Block *b = lists[c].pop()) {
+                    ::operator delete(b, (c + 1) * kGranule);
+                }
+            }
+        }
+    };
+
+    struct Cache {
+        List lists[kClasses];
+
+        // central() 을 먼저 만들어 두어야 스레드 캐시보다 늦게 소멸합니다.
+        Cache() { FramePool::central(); }
+
+        Block *refill(size_t c) {
+            {
+                Central &central = FramePool::central();
+                std::lock_guard<std::mutex> lock(central.mutex);
+                List batch = central.lists[c].take(kBatch);
+                lists[c].splice(batch);
+            }
+            if (Block *b = lists[c].pop()) {
+                return b;
+            }
+            return static_cast<Block *>(::operator new((c + 1) * kGranule));
+        }
+
+        void spill(size_t c) noexcept {
+            List batch = lists[c].take(kBatch);
+            Central &central = FramePool::central();
+            std::lock_guard<std::mutex> lock(central.mutex);
+            central.lists[c].splice(batch);
+        }
+
+        ~Cache() {
+            Central &central = FramePool::central();
+            std::lock_guard<std::mutex> lock(central.mutex);
+            for (size_t c = 0; c < kClasses; ++c) {
+                central.lists[c].splice(lists[c]);
+            }
+        }
+    };
+
+    static size_t sizeClass(size_t size) noexcept { return size == 0 ? 0 : (size - 1) / kGranule; }
+
+    static Central &central() {
+        static Central instance;
+        return instance;
+    }
+
+    static Cache &local() {
+        thread_local Cache cache;
+        return cache;
+    }
+};
+
+// 코루틴 프레임 뒤에 붙이는 꼬리표. 프레임을 어떻게 돌려줄지 기억합니다.
+// 사용자 할당자로 만든 프레임은 할당자 복사본도 꼬리표 뒤에 둡니다.
+namespace detail {
+
+struct FrameTrailer {
+    void (*release)(void *frame, size_t frame_size) noexcept;
+};
+
+// 프레임 크기를 꼬리표가 정렬되도록 올림
+constexpr size_t frameSpan(size_t size) noexcept {
+    constexpr size_t a = alignof(std::max_align_t);
+    return (size + a - 1) & ~(a - 1);
+}
+
+inline FrameTrailer *trailerOf(void *frame, size_t size) noexcept {
+    return reinterpret_cast<FrameTrailer *>(static_cast<std::byte *>(frame) + frameSpan(size));
+}
+
+// FramePool 에서 가져온 프레임
+inline void *poolFrame(size_t size) {
+    size_t total = frameSpan(size) + sizeof(FrameTrailer);
+    void *frame = FramePool::allocate(total);
+    trailerOf(frame, size)->release = [](void *p, size_t n) noexcept {
+        FramePool::deallocate(p, frameSpan(n) + sizeof(FrameTrailer));
+    };
+    return frame;
+}
+
+// 사용자 할당자로 가져온 프레임. 할당자는 max_align_t 단위로 rebind 해서 씁니다.
+template <typename Alloc>
+void *allocatorFrame(size_t size, const Alloc &alloc) {
+    using Unit = std::max_align_t;
+    using Rebound = typename std::allocator_traits<Alloc>::template rebind_alloc<Unit>;
+    using Traits = std::allocator_traits<Rebound>;
+    static_assert(alignof(Rebound) <= alignof(Unit), "allocator alignment is too large");
+
+    constexpr size_t kAllocOffset = frameSpan(sizeof(FrameTrailer));
+    size_t bytes = frameSpan(size) + kAllocOffset + sizeof(Rebound);
+    size_t units = (bytes + sizeof(Unit) - 1) / sizeof(Unit);
+
+    Rebound rebound(alloc);
+    void *frame = Traits::allocate(rebound, units);
+    FrameTrailer *trailer = trailerOf(frame, size);
+    new (reinterpret_cast<std::byte *>(trailer) + kAllocOffset) Rebound(std::move(rebound));
+    trailer->release = [](void *p, size_t n) noexcept {
+        FrameTrailer *t = trailerOf(p, n);
+        Rebound *stored = std::launder(
+            reinterpret_cast<Rebound *>(reinterpret_cast<std::byte *>(t) + kAllocOffset));
+        Rebound local(std::move(*stored));
+        stored->~Rebound();
+        size_t count = (frameSpan(n) + kAllocOffset + sizeof(Rebound) + sizeof(Unit) - 1) /
+                       sizeof(Unit);
+        Traits::deallocate(local, static_cast<Unit *>(p), count);
+    };
+    return frame;
+}
+
+inline void releaseFrame(void *frame, size_t size) noexcept {
+    trailerOf(frame, size)->release(frame, size);
+}
+
+} // namespace detail
@@ -0,0 +1,519 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <linux/io_uring.h>
+#include <mutex>
+#include <span>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "task.hpp"
+
+// IoContext 클래스 정의
+// 파일/소켓 I/O 를 co_await 할 수 있게 해 주는 단일 스레드 reactor 입니다.
+//  - io_uring 을 liburing 없이 시스템 콜(io_uring_setup/enter/register)로 직접 씁니다.
+//    커널이 io_uring 을 막아 두었으면(ENOSYS, EPERM 등) epoll 로 대신합니다.
+//  - 코루틴이 co_await 하면 SQE 만 채워 두고, 루프가 한 번 돌 때(tick) 모인 SQE 를
+//    io_uring_enter 한 번으로 제출하면서 완료를 기다립니다.
+//  - registerBuffers() 로 등록한 버퍼는 read_fixed/write_fixed 로 씁니다.
+//    커널이 매번 페이지를 고정(pin)하고 풀지 않아도 됩니다.
+//  - 결과는 시스템 콜처럼 바이트 수(accept 는 새 fd)이고, 실패하면 -errno 입니다.
+// 모든 co_await 와 run() 은 IoContext 를 만든 스레드에서 해야 합니다.
+//
+// epoll 로 대신할 때:
+//  - 일반 파일은 epoll 로 기다릴 수 없으므로 pread/pwrite 를 바로 수행합니다. (블로킹)
+//  - 소켓은 MSG_DONTWAIT 로 먼저 시도하고, EAGAIN 이면 준비될 때까지 기다립니다.
+//    accept 하는 소켓에는 O_NONBLOCK 을 켭니다.
+class IoContext {
+public:
+    enum class Backend { Auto, IoUring, Epoll };
+
+    explicit IoContext(unsigned entries = 256, Backend backend = Backend::Auto) {
+        if (backend != Backend::Epoll && setupRing(entries)) {
+            return;
+        }
+        if (backend == Backend::IoUring) {
+            std::cerr << "io_uring is not available, using epoll" << std::endl;
+        }
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd_ < 0) {
+            std::cerr << "epoll_create1 failed: " << strerror(errno) << std::endl;
+        }
+    }
+
+    IoContext(const IoContext &) = delete;
+    IoContext &operator=(const IoContext &) = delete;
+
+    ~IoContext() {
+        closeRing();
+        if (epoll_fd_ >= 0) {
+            close(epoll_fd_);
+        }
+    }
+
+    const char *backend() const { return ring_fd_ >= 0 ? "io_uring" : "epoll"; }
+
+    // read_fixed/write_fixed 용 버퍼 등록. 등록된 순서가 buf_index 입니다.
+    // epoll 에서는 아무 일도 하지 않고, read_fixed/write_fixed 도 pread/pwrite 로 합니다.
+    bool registerBuffers(std::span<const iovec> buffers) {
+        if (ring_fd_ < 0) {
+            return true;
+        }
+        if (registered_) {
+            syscall(__NR_io_uring_register, ring_fd_, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+            registered_ = false;
+        }
+        if (syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_BUFFERS, buffers.data(),
+                    static_cast<unsigned>(buffers.size())) < 0) {
+            std::cerr << "IORING_REGISTER_BUFFERS failed: " << strerror(errno) << std::endl;
+            return false;
+        }
+        registered_ = true;
+        return true;
+    }
+
+    // co_await 할 수 있는 I/O 작업. 결과는 int (바이트 수, fd 또는 -errno)
+    auto read_at(int fd, void *buf, size_t len, off_t offset) {
+        return Awaiter{*this, op(IORING_OP_READ, fd, buf, len, offset)};
+    }
+    auto write_at(int fd, const void *buf, size_t len, off_t offset) {
+        return Awaiter{*this, op(IORING_OP_WRITE, fd, const_cast<void *>(buf), len, offset)};
+    }
+    // buf 는 registerBuffers() 로 등록한 buf_index 번째 버퍼 안에 있어야 합니다.
+    auto read_fixed(int fd, void *buf, size_t len, off_t offset, int buf_index) {
+        Operation o = op(IORING_OP_READ_FIXED, fd, buf, len, offset);
+        o.buf_index = buf_index;
+        return Awaiter{*this, o};
+    }
+    auto write_fixed(int fd, const void *buf, size_t len, off_t offset, int buf_index) {
+        Operation o = op(IORING_OP_WRITE_FIXED, fd, const_cast<void *>(buf), len, offset);
+        o.buf_index = buf_index;
+        return Awaiter{*this, o};
+    }
+    auto accept(int fd, sockaddr *addr = nullptr, socklen_t *addrlen = nullptr) {
+        Operation o = op(IORING_OP_ACCEPT, fd, addr, 0, 0);
+        o.addrlen = addrlen;
+        return Awaiter{*this, o};
+    }
+    auto recv(int fd, void *buf, size_t len, int flags = 0) {
+        Operation o = op(IORING_OP_RECV, fd, buf, len, 0);
+        o.flags = flags;
+        return Awaiter{*this, o};
+    }
+    auto send(int fd, const void *buf, size_t len, int flags = MSG_NOSIGNAL) {
+        Operation o = op(IORING_OP_SEND, fd, const_cast<void *>(buf), len, 0);
+        o.flags = flags;
+        return Awaiter{*this, o};
+    }
+
+    // task 가 끝날 때까지 이 스레드에서 루프를 돌리고 결과를 돌려 줍니다.
+    template <typename T>
+    decltype(auto) run(Task<T> task) {
+        detail::SyncState state;
+        detail::SyncRunner runner = detail::syncRun(task);
+        runner.handle.promise().state = &state;
+        runner.handle.resume();
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(state.mutex);
+                if (state.done) {
+                    break;
+                }
+                // 기다리는 I/O 가 없으면 다른 스레드(Scheduler 등)에서 끝나기를 기다립니다.
+                if (pending() == 0) {
+                    state.cv.wait(lock, [&] { return state.done || pending() != 0; });
+                    continue;
+                }
+            }
+            tick();
+        }
+        if constexpr (std::is_void_v<T>) {
+            task.result();
+        } else {
+            return T(task.result());
+        }
+    }
+
+    // 모인 SQE 를 제출하고, 완료된 작업의 코루틴을 재개합니다.
+    // 재개할 것이 없으면 하나가 끝날 때까지 기다립니다.
+    void tick() {
+        if (ring_fd_ >= 0) {
+            tickRing();
+        } else {
+            tickEpoll();
+        }
+    }
+
+    // 제출됐지만 아직 완료되지 않은 작업 수
+    size_t pending() const { return in_flight_ + unsubmitted_ + armed_ + ready_.size(); }
+
+private:
+    struct Operation {
+        uint8_t opcode = 0;
+        int fd = -1;
+        void *buf = nullptr;
+        size_t len = 0;
+        off_t offset = 0;
+        int flags = 0;
+        int buf_index = 0;
+        socklen_t *addrlen = nullptr;
+        int result = 0;
+        std::coroutine_handle<> handle;
+    };
+
+    struct Awaiter {
+        IoContext &ctx;
+        Operation op;
+
+        bool await_ready() noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) {
+            op.handle = h;
+            ctx.submit(op);
+        }
+        int await_resume() noexcept { return op.result; }
+    };
+
+    static Operation op(uint8_t opcode, int fd, void *buf, size_t len, off_t offset) {
+        Operation o;
+        o.opcode = opcode;
+        o.fd = fd;
+        o.buf = buf;
+        o.len = len;
+        o.offset = offset;
+        return o;
+    }
+
+    void submit(Operation &op) {
+        if (ring_fd_ >= 0) {
+            prepare(op);
+        } else {
+            submitEpoll(op);
+        }
+    }
+
+    // ---- io_uring ----
+
+    bool setupRing(unsigned entries) {
+        io_uring_params p{};
+        int fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &p));
+        if (fd < 0) {
+            return false;
+        }
+        ring_fd_ = fd;
+
+        sq_ring_size_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cq_ring_size_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single) {
+            sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+        }
+        sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        fd, IORING_OFF_SQ_RING);
+        cq_ring_ = single ? sq_ring_
+                          : mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                                 MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        sqes_size_ = p.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                     IORING_OFF_SQES);
+        if (sq_ring_ == MAP_FAILED || cq_ring_ == MAP_FAILED || sqes_ == MAP_FAILED) {
+            std::cerr << "io_uring mmap failed: " << strerror(errno) << std::endl;
+            closeRing();
+            return false;
+        }
+
+        auto *sq = static_cast<uint8_t *>(sq_ring_);
+        sq_tail_ = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+        sq_entries_ = p.sq_entries;
+        // SQE 는 순서대로 쓰므로 인덱스 배열은 처음에 한 번만 채웁니다.
+        auto *array = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+        for (unsigned i = 0; i < p.sq_entries; ++i) {
+            array[i] = i;
+        }
+        auto *cq = static_cast<uint8_t *>(cq_ring_);
+        cq_head_ = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe *>(cq + p.cq_off.cqes);
+        cq_entries_ = p.cq_entries;
+        local_tail_ = *sq_tail_;
+        return true;
+    }
+
+    void closeRing() {
+        if (ring_fd_ < 0) {
+            return;
+        }
+        if (sq_ring_ != MAP_FAILED && sq_ring_ != nullptr) {
+            munmap(sq_ring_, sq_ring_size_);
+        }
+        if (cq_ring_ != sq_ring_ && cq_ring_ != MAP_FAILED && cq_ring_ != nullptr) {
+            munmap(cq_ring_, cq_ring_size_);
+        }
+        if (sqes_ != MAP_FAILED && sqes_ != nullptr) {
+            munmap(sqes_, sqes_size_);
+        }
+        sq_ring_ = cq_ring_ = sqes_ = nullptr;
+        close(ring_fd_);
+        ring_fd_ = -1;
+    }
+
+    void prepare(Operation &op) {
+        // SQ 가 가득 찼거나 CQ 가 넘칠 만큼 작업이 나가 있으면 먼저 제출합니다.
+        while (unsubmitted_ >= sq_entries_ || in_flight_ + unsubmitted_ >= cq_entries_) {
+            enter(in_flight_ + unsubmitted_ >= cq_entries_ ? 1 : 0);
+            reap();
+        }
+        io_uring_sqe *sqe = &static_cast<io_uring_sqe *>(sqes_)[local_tail_ & sq_mask_];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = op.opcode;
+        sqe->fd = op.fd;
+        sqe->addr = reinterpret_cast<uint64_t>(op.buf);
+        sqe->len = static_cast<uint32_t>(op.len);
+        sqe->user_data = reinterpret_cast<uint64_t>(&op);
+        switch (op.opcode) {
+        case IORING_OP_READ:
+        case IORING_OP_WRITE:
+            sqe->off = static_cast<uint64_t>(op.offset);
+            break;
+        case IORING_OP_READ_FIXED:
+        case IORING_OP_WRITE_FIXED:
+            sqe->off = static_cast<uint64_t>(op.offset);
+            sqe->buf_index = static_cast<uint16_t>(op.buf_index);
+            break;
+        case IORING_OP_ACCEPT:
+            sqe->len = 0;
+            sqe->addr2 = reinterpret_cast<uint64_t>(op.addrlen);
+            sqe->accept_flags = SOCK_CLOEXEC;
+            break;
+        case IORING_OP_RECV:
+        case IORING_OP_SEND:
+            sqe->msg_flags = static_cast<uint32_t>(op.flags);
+            break;
+        }
+        ++local_tail_;
+        ++unsubmitted_;
+    }
+
+    // 모인 SQE 를 한 번에 제출하고, min_complete 개가 끝날 때까지 기다립니다.
+    void enter(unsigned min_complete) {
+        std::atomic_ref<unsigned>(*sq_tail_).store(local_tail_, std::memory_order_release);
+        unsigned flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+        for (;;) {
+            long ret = syscall(__NR_io_uring_enter, ring_fd_, unsubmitted_, min_complete, flags,
+                               nullptr, 0);
+            if (ret >= 0) {
+                in_flight_ += static_cast<size_t>(ret);
+                unsubmitted_ -= static_cast<unsigned>(ret);
+                if (unsubmitted_ == 0 || min_complete > 0) {
+                    return;
+                }
+                continue;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EBUSY || errno == EAGAIN) {
+                // CQ 가 넘쳤거나 커널 자원이 모자람: 완료를 먼저 거둡니다.
+                reap();
+                flags = 0;
+                min_complete = 0;
+                continue;
+            }
+            std::cerr << "io_uring_enter failed: " << strerror(errno) << std::endl;
+            return;
+        }
+    }
+
+    // 완료된 CQE 를 모두 거두고 코루틴을 재개합니다.
+    // head 를 먼저 옮겨 두므로, 재개된 코루틴이 새 작업을 제출해도 괜찮습니다.
+    void reap() {
+        unsigned head = *cq_head_;
+        unsigned tail = std::atomic_ref<unsigned>(*cq_tail_).load(std::memory_order_acquire);
+        if (head == tail) {
+            return;
+        }
+        completed_.clear();
+        for (; head != tail; ++head) {
+            const io_uring_cqe &cqe = cqes_[head & cq_mask_];
+            auto *op = reinterpret_cast<Operation *>(cqe.user_data);
+            op->result = cqe.res;
+            completed_.push_back(op->handle);
+        }
+        std::atomic_ref<unsigned>(*cq_head_).store(head, std::memory_order_release);
+        in_flight_ -= completed_.size();
+        std::vector<std::coroutine_handle<>> batch;
+        batch.swap(completed_);
+        for (std::coroutine_handle<> h : batch) {
+            h.resume();
+        }
+        if (completed_.empty()) {
+            completed_.swap(batch);  // 용량을 다시 씁니다
+        }
+    }
+
+    void tickRing() {
+        if (unsubmitted_ == 0 && in_flight_ == 0) {
+            return;
+        }
+        enter(1);
+        reap();
+    }
+
+    // ---- epoll ----
+
+    // 소켓마다 읽는 쪽(accept, recv) 하나와 쓰는 쪽(send) 하나까지 기다릴 수 있습니다.
+    struct Waiters {
+        Operation *reader = nullptr;
+        Operation *writer = nullptr;
+        bool registered = false;
+        bool armed = false;
+    };
+
+    // 바로 끝나면 true. EAGAIN 이면 false 를 돌려주고 결과는 건드리지 않습니다.
+    static bool attempt(Operation &op) {
+        ssize_t n = 0;
+        switch (op.opcode) {
+        case IORING_OP_READ:
+        case IORING_OP_READ_FIXED:
+            n = pread(op.fd, op.buf, op.len, op.offset);
+            break;
+        case IORING_OP_WRITE:
+        case IORING_OP_WRITE_FIXED:
+            n = pwrite(op.fd, op.buf, op.len, op.offset);
+            break;
+        case IORING_OP_ACCEPT:
+            n = accept4(op.fd, static_cast<sockaddr *>(op.buf), op.addrlen, SOCK_CLOEXEC);
+            break;
+        case IORING_OP_RECV:
+            n = ::recv(op.fd, op.buf, op.len, op.flags | MSG_DONTWAIT);
+            break;
+        case IORING_OP_SEND:
+            n = ::send(op.fd, op.buf, op.len, op.flags | MSG_DONTWAIT);
+            break;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return false;
+        }
+        op.result = n < 0 ? -errno : static_cast<int>(n);
+        return true;
+    }
+
+    void submitEpoll(Operation &op) {
+        if (op.opcode == IORING_OP_ACCEPT) {
+            int fl = fcntl(op.fd, F_GETFL);
+            if (fl >= 0 && (fl & O_NONBLOCK) == 0) {
+                fcntl(op.fd, F_SETFL, fl | O_NONBLOCK);
+            }
+        }
+        // 재개는 다음 tick 에서 합니다. await_suspend 안에서 바로 재개하면 스택이 자랍니다.
+        if (attempt(op)) {
+            ready_.push_back(op.handle);
+            return;
+        }
+        Waiters &w = waiters_[op.fd];
+        bool writing = op.opcode == IORING_OP_SEND;
+        (writing ? w.writer : w.reader) = &op;
+        arm(op.fd, w);
+    }
+
+    void arm(int fd, Waiters &w) {
+        epoll_event ev{};
+        ev.events = EPOLLONESHOT | (w.reader ? EPOLLIN : 0u) | (w.writer ? EPOLLOUT : 0u);
+        ev.data.fd = fd;
+        if (epoll_ctl(epoll_fd_, w.registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &ev) < 0) {
+            int error = errno;
+            for (Operation **slot : {&w.reader, &w.writer}) {
+                if (*slot != nullptr) {
+                    (*slot)->result = -error;
+                    ready_.push_back((*slot)->handle);
+                    *slot = nullptr;
+                }
+            }
+            return;
+        }
+        w.registered = true;
+        if (!w.armed) {
+            w.armed = true;
+            ++armed_;
+        }
+    }
+
+    void tickEpoll() {
+        if (ready_.empty() && armed_ > 0) {
+            epoll_event events[64];
+            int n = epoll_wait(epoll_fd_, events, 64, -1);
+            for (int i = 0; i < n; ++i) {
+                int fd = events[i].data.fd;
+                Waiters &w = waiters_[fd];
+                w.armed = false;
+                --armed_;
+                uint32_t e = events[i].events;
+                bool failed = (e & (EPOLLERR | EPOLLHUP)) != 0;
+                if (w.reader != nullptr && ((e & EPOLLIN) || failed) && attempt(*w.reader)) {
+                    ready_.push_back(w.reader->handle);
+                    w.reader = nullptr;
+                }
+                if (w.writer != nullptr && ((e & EPOLLOUT) || failed) && attempt(*w.writer)) {
+                    ready_.push_back(w.writer->handle);
+                    w.writer = nullptr;
+                }
+                if (w.reader != nullptr || w.writer != nullptr) {
+                    arm(fd, w);
+                } else {
+                    // 다음 작업이 올 때까지 해제해 둡니다. (fd 가 닫혀도 문제없도록)
+                    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+                    waiters_.erase(fd);
+                }
+            }
+        }
+        std::vector<std::coroutine_handle<>> batch;
+        batch.swap(ready_);
+        for (std::coroutine_handle<> h : batch) {
+            h.resume();
+        }
+    }
+
+    // io_uring
+    int ring_fd_ = -1;
+    void *sq_ring_ = nullptr;
+    void *cq_ring_ = nullptr;
+    void *sqes_ = nullptr;
+    size_t sq_ring_size_ = 0;
+    size_t cq_ring_size_ = 0;
+    size_t sqes_size_ = 0;
+    unsigned *sq_tail_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned sq_entries_ = 0;
+    unsigned *cq_head_ = nullptr;
+    unsigned *cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    unsigned cq_entries_ = 0;
+    io_uring_cqe *cqes_ = nullptr;
+    unsigned local_tail_ = 0;
+    unsigned unsubmitted_ = 0;
+    size_t in_flight_ = 0;
+    bool registered_ = false;
+    std::vector<std::coroutine_handle<>> completed_;
+
+    // epoll
+    int epoll_fd_ = -1;
+    size_t armed_ = 0;
+    std::unordered_map<int, Waiters> waiters_;
+    std::vector<std::coroutine_handle<>> ready_;
+};
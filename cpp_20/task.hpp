@@ -0,0 +1,627 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "frame_pool.hpp"
+
+// Task<T> 클래스 정의
+// co_await 할 수 있는 지연 실행(lazy) 코루틴 반환 객체입니다.
+//  - 만들어질 때는 본문을 실행하지 않고, 누군가 co_await 할 때 시작합니다.
+//  - co_await 하면 그 자리에서 Task 를 resume() 합니다. Task 가 그 안에서 끝나면
+//    await_suspend 가 false 를 돌려 기다리던 코루틴이 바로 이어서 실행되므로,
+//    동기적으로 끝나는 Task 를 수백만 번 연달아 co_await 해도 스택이 자라지 않습니다.
+//    꼬리 호출 최적화에 기대지 않으므로 -O0 이나 sanitizer 빌드에서도 마찬가지입니다.
+//  - 다른 스레드에서 나중에 끝나면 final_suspend 에서 기다리던 코루틴으로
+//    대칭 전환(symmetric transfer)합니다. 어느 쪽이 이어서 실행할지는 promise 의
+//    handoff 플래그를 먼저 바꾼 쪽이 정합니다.
+//  - co_return 값과 예외는 promise 에 보관했다가 co_await 한 쪽에 돌려 줍니다.
+//    (예외는 거기서 다시 던집니다)
+//  - 프레임은 FramePool 에서 가져옵니다. 첫 인자로 std::allocator_arg 와 할당자를
+//    넘기면 그 할당자를 씁니다. (멤버 함수면 this 다음 인자)
+//        Task<int> f(std::allocator_arg_t, MyAlloc alloc, int x);
+// Task 는 이동만 가능하고, 한 번만 co_await 합니다.
+template <typename T = void>
+class Task;
+
+namespace detail {
+
+// co_return 값과 예외 보관. T 가 void 인 경우만 따로 둡니다.
+template <typename T>
+class TaskResult {
+public:
+    template <typename U>
+    void return_value(U &&value) {
+        result_.template emplace<1>(std::forward<U>(value));
+    }
+    void unhandled_exception() { result_.template emplace<2>(std::current_exception()); }
+
+    T take() {
+        if (result_.index() == 2) {
+            std::rethrow_exception(std::get<2>(result_));
+        }
+        return std::move(std::get<1>(result_));
+    }
+
+private:
+    std::variant<std::monostate, T, std::exception_ptr> result_;
+};
+
+template <>
+class TaskResult<void> {
+public:
+    void return_void() {}
+    void unhandled_exception() { error_ = std::current_exception(); }
+
+    void take() {
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+    }
+
+private:
+    std::exception_ptr error_;
+};
+
+// when_all 결과 tuple 에서 void 자리를 채우는 타입
+template <typename T>
+using NonVoid = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+} // namespace detail
+
+template <typename T>
+class Task {
+public:
+    struct promise_type : detail::TaskResult<T> {
+        Task get_return_object() {
+            return Task{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+
+        // co_await 될 때까지 시작하지 않습니다.
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        // Starter 의 resume() 안에서 끝났으면 그쪽으로 돌아가고, Starter 가 이미
+        // 중단해 있으면 기다리던 코루틴으로 넘어갑니다.
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+                promise_type &p = h.promise();
+                if (p.handoff.exchange(true, std::memory_order_acq_rel) && p.continuation) {
+                    return p.continuation;
+                }
+                return std::noop_coroutine();
+            }
+            void await_resume() noexcept {}
+        };
+        FinalAwaiter final_suspend() noexcept { return {}; }
+
+        // 코루틴 프레임 할당. 해제할 때는 프레임 뒤의 꼬리표를 보고 돌려줍니다.
+        static void *operator new(size_t size) { return detail::poolFrame(size); }
+
+        template <typename Alloc, typename... Args>
+        static void *operator new(size_t size, std::allocator_arg_t, const Alloc &alloc,
+                                  const Args &...) {
+            return detail::allocatorFrame(size, alloc);
+        }
+
+        template <typename This, typename Alloc, typename... Args>
+        static void *operator new(size_t size, const This &, std::allocator_arg_t,
+                                  const Alloc &alloc, const Args &...) {
+            return detail::allocatorFrame(size, alloc);
+        }
+
+        static void operator delete(void *frame, size_t size) noexcept {
+            detail::releaseFrame(frame, size);
+        }
+
+        std::coroutine_handle<> continuation;
+        // Starter 와 FinalAwaiter 중 나중에 도착한 쪽이 continuation 을 재개합니다.
+        std::atomic<bool> handoff{false};
+    };
+
+    Task() = default;
+    Task(Task &&other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+    Task &operator=(Task &&other) noexcept {
+        if (this != &other) {
+            reset();
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+    ~Task() { reset(); }
+
+    bool valid() const { return static_cast<bool>(handle_); }
+    bool done() const { return handle_ && handle_.done(); }
+
+    // co_await task: 시작(또는 이어서 실행)하고 끝나면 결과를 돌려 받습니다.
+    auto operator co_await() && noexcept {
+        struct Awaiter : Starter {
+            decltype(auto) await_resume() { return this->task.promise().take(); }
+        };
+        return Awaiter{{handle_}};
+    }
+
+    // co_await task.when_ready(): 끝나기만 기다리고 결과는 꺼내지 않습니다.
+    // 결과는 나중에 result() 로 꺼냅니다. (when_all/when_any 에서 사용)
+    auto when_ready() noexcept {
+        struct Awaiter : Starter {
+            void await_resume() noexcept {}
+        };
+        return Awaiter{{handle_}};
+    }
+
+    // 끝난 Task 의 결과. 예외로 끝났으면 다시 던집니다.
+    decltype(auto) result() { return handle_.promise().take(); }
+
+private:
+    explicit Task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+    struct Starter {
+        std::coroutine_handle<promise_type> task;
+
+        bool await_ready() noexcept { return !task || task.done(); }
+        // 이미 끝났으면 false 를 돌려 중단하지 않고 이어갑니다.
+        bool await_suspend(std::coroutine_handle<> awaiting) noexcept {
+            task.promise().continuation = awaiting;
+            task.resume();
+            return !task.promise().handoff.exchange(true, std::memory_order_acq_rel);
+        }
+    };
+
+    void reset() {
+        if (handle_) {
+            handle_.destroy();
+            handle_ = nullptr;
+        }
+    }
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+// Scheduler 클래스 정의
+// 준비된 코루틴을 워커 스레드 풀에서 재개합니다.
+//  - co_await scheduler.schedule() : 현재 코루틴을 풀의 큐로 옮깁니다.
+//  - co_await scheduler.sleep_for(d) : d 가 지난 뒤 풀에서 재개합니다.
+//    기다리는 동안 스레드를 잡고 있지 않으므로, 스레드 몇 개로 수십만 개의 대기를
+//    처리할 수 있습니다. (타이머는 마감 시간 순 힙 하나로 관리합니다)
+//  - spawn(task) : 결과를 기다리지 않는 작업을 풀에서 시작합니다.
+// 소멸자는 큐에 남은 코루틴을 모두 실행한 뒤 스레드를 종료합니다.
+// 아직 오지 않은 타이머에 걸린 코루틴은 재개하지 않으므로, 그 전에 끝까지 기다려야 합니다.
+class Scheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit Scheduler(size_t threads = std::thread::hardware_concurrency()) {
+        if (threads == 0) {
+            threads = 1;
+        }
+        for (size_t i = 0; i < threads; ++i) {
+            workers_.emplace_back([this] { run(); });
+        }
+    }
+
+    Scheduler(const Scheduler &) = delete;
+    Scheduler &operator=(const Scheduler &) = delete;
+
+    ~Scheduler() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for (std::thread &t : workers_) {
+            t.join();
+        }
+    }
+
+    size_t threads() const { return workers_.size(); }
+
+    auto schedule() noexcept {
+        struct Awaiter {
+            Scheduler &scheduler;
+            bool await_ready() noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h) { scheduler.post(h); }
+            void await_resume() noexcept {}
+        };
+        return Awaiter{*this};
+    }
+
+    auto sleep_until(Clock::time_point deadline) noexcept {
+        struct Awaiter {
+            Scheduler &scheduler;
+            Clock::time_point deadline;
+            bool await_ready() noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h) { scheduler.postAt(deadline, h); }
+            void await_resume() noexcept {}
+        };
+        return Awaiter{*this, deadline};
+    }
+
+    template <typename Rep, typename Period>
+    auto sleep_for(std::chrono::duration<Rep, Period> d) noexcept {
+        return sleep_until(Clock::now() + std::chrono::duration_cast<Clock::duration>(d));
+    }
+
+    void spawn(Task<void> task) { detached(*this, std::move(task)); }
+
+    // 코루틴 핸들을 큐에 넣습니다. awaiter 를 직접 만드는 경우에 사용합니다.
+    void post(std::coroutine_handle<> h) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ready_.push_back(h);
+        }
+        cv_.notify_one();
+    }
+
+    void postAt(Clock::time_point deadline, std::coroutine_handle<> h) {
+        bool earliest;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            earliest = timers_.empty() || deadline < timers_.top().deadline;
+            timers_.push(Timer{deadline, h});
+        }
+        // 가장 이른 마감이 바뀐 경우에만 자고 있는 워커의 대기 시간을 고쳐 줍니다.
+        if (earliest) {
+            cv_.notify_one();
+        }
+    }
+
+private:
+    struct Timer {
+        Clock::time_point deadline;
+        std::coroutine_handle<> handle;
+        bool operator>(const Timer &other) const { return deadline > other.deadline; }
+    };
+
+    // spawn() 용 코루틴. 바로 시작하고, 끝나면 스스로 프레임을 해제합니다.
+    struct Detached {
+        struct promise_type {
+            Detached get_return_object() noexcept { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() noexcept {}
+            void unhandled_exception() noexcept {
+                try {
+                    throw;
+                } catch (const std::exception &e) {
+                    std::cerr << "Unhandled exception in spawned task: " << e.what() << std::endl;
+                } catch (...) {
+                    std::cerr << "Unhandled exception in spawned task" << std::endl;
+                }
+            }
+        };
+    };
+
+    static Detached detached(Scheduler &scheduler, Task<void> task) {
+        co_await scheduler.schedule();
+        co_await std::move(task);
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            Clock::time_point now = Clock::now();
+            while (!timers_.empty() && timers_.top().deadline <= now) {
+                ready_.push_back(timers_.top().handle);
+                timers_.pop();
+            }
+            if (!ready_.empty()) {
+                std::coroutine_handle<> h = ready_.front();
+                ready_.pop_front();
+                // 다른 워커도 깨어 있어야 할 만큼 일이 남아 있으면 하나 더 깨웁니다.
+                bool more = !ready_.empty();
+                lock.unlock();
+                if (more) {
+                    cv_.notify_one();
+                }
+                h.resume();
+                lock.lock();
+                continue;
+            }
+            if (stop_) {
+                break;
+            }
+            if (timers_.empty()) {
+                cv_.wait(lock);
+            } else {
+                // 기다리는 동안 힙이 바뀔 수 있으므로 마감 시간을 복사해 둡니다.
+                Clock::time_point deadline = timers_.top().deadline;
+                cv_.wait_until(lock, deadline);
+            }
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::coroutine_handle<>> ready_;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers_;
+    bool stop_ = false;
+    std::vector<std::thread> workers_;
+};
+
+namespace detail {
+
+// 동기 대기용 코루틴. 끝나면 기다리는 스레드를 깨웁니다.
+struct SyncState {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool done = false;
+};
+
+struct SyncRunner {
+    struct promise_type {
+        SyncState *state = nullptr;
+
+        SyncRunner get_return_object() {
+            return SyncRunner{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        // 프레임은 sync_wait 가 해제합니다. 잠금을 쥔 채로 깨워야 깨어난 스레드가
+        // state 를 먼저 없애는 일이 없습니다.
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+            void await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+                SyncState &s = *h.promise().state;
+                std::lock_guard<std::mutex> lock(s.mutex);
+                s.done = true;
+                s.cv.notify_all();
+            }
+            void await_resume() noexcept {}
+        };
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept {}  // 결과는 Task 쪽에 남습니다.
+    };
+
+    std::coroutine_handle<promise_type> handle;
+
+    SyncRunner(SyncRunner &&other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    ~SyncRunner() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+private:
+    explicit SyncRunner(std::coroutine_handle<promise_type> h) : handle(h) {}
+};
+
+template <typename T>
+SyncRunner syncRun(Task<T> &task) {
+    co_await task.when_ready();
+}
+
+// when_all 의 자식 하나를 감싸는 코루틴.
+// 끝날 때 카운터를 줄이고, 마지막이면 기다리던 코루틴으로 대칭 전환합니다.
+struct AllCounter {
+    std::atomic<size_t> count{0};
+    std::coroutine_handle<> waiter;
+
+    bool arrive() noexcept { return count.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+};
+
+struct AllRunner {
+    struct promise_type {
+        AllCounter *counter = nullptr;
+
+        AllRunner get_return_object() {
+            return AllRunner{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+                AllCounter &c = *h.promise().counter;
+                return c.arrive() ? c.waiter : std::noop_coroutine();
+            }
+            void await_resume() noexcept {}
+        };
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept {}
+    };
+
+    std::coroutine_handle<promise_type> handle;
+
+    AllRunner(AllRunner &&other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    ~AllRunner() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+private:
+    explicit AllRunner(std::coroutine_handle<promise_type> h) : handle(h) {}
+};
+
+template <typename T>
+AllRunner allRun(Task<T> &task) {
+    co_await task.when_ready();
+}
+
+// 자식들을 모두 시작하고, 마지막 자식이 끝나면 재개합니다.
+// 카운터를 자식 수 + 1 로 시작해서, await_suspend 가 자식을 다 시작하기 전에
+// 재개되는 일이 없게 합니다.
+class AllAwaiter {
+public:
+    explicit AllAwaiter(std::vector<AllRunner> runners) : runners_(std::move(runners)) {}
+
+    bool await_ready() const noexcept { return runners_.empty(); }
+
+    bool await_suspend(std::coroutine_handle<> waiter) noexcept {
+        counter_.count.store(runners_.size() + 1, std::memory_order_relaxed);
+        counter_.waiter = waiter;
+        for (AllRunner &r : runners_) {
+            r.handle.promise().counter = &counter_;
+            r.handle.resume();
+        }
+        return !counter_.arrive();
+    }
+
+    void await_resume() const noexcept {}
+
+private:
+    std::vector<AllRunner> runners_;
+    AllCounter counter_;
+};
+
+template <typename T>
+NonVoid<T> takeResult(Task<T> &task) {
+    if constexpr (std::is_void_v<T>) {
+        task.result();
+        return {};
+    } else {
+        return task.result();
+    }
+}
+
+// when_any 의 공유 상태. 진 자식들이 나중에 끝날 때까지 살아 있어야 하므로
+// 자식 Task 들도 여기에 보관합니다.
+template <typename T>
+struct AnyState {
+    std::vector<Task<T>> tasks;
+    std::atomic<bool> won{false};
+    std::atomic<int> pending{2};  // 승자 + await_suspend
+    size_t index = 0;
+    std::coroutine_handle<> waiter;
+
+    bool arrive() noexcept { return pending.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+};
+
+// 스스로 해제되는 when_any 자식 코루틴
+struct AnyRunner {
+    struct promise_type {
+        AnyRunner get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept {}
+    };
+};
+
+template <typename T>
+AnyRunner anyRun(std::shared_ptr<AnyState<T>> state, size_t i) {
+    co_await state->tasks[i].when_ready();
+    if (!state->won.exchange(true, std::memory_order_acq_rel)) {
+        state->index = i;
+        if (state->arrive()) {
+            // 승자는 한 번뿐이므로 중첩되는 resume() 도 한 단계뿐입니다.
+            state->waiter.resume();
+        }
+    }
+}
+
+template <typename T>
+class AnyAwaiter {
+public:
+    explicit AnyAwaiter(std::shared_ptr<AnyState<T>> state) : state_(std::move(state)) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> waiter) {
+        state_->waiter = waiter;
+        for (size_t i = 0; i < state_->tasks.size() && !state_->won.load(); ++i) {
+            anyRun(state_, i);
+        }
+        return !state_->arrive();
+    }
+
+    void await_resume() const noexcept {}
+
+private:
+    std::shared_ptr<AnyState<T>> state_;
+};
+
+} // namespace detail
+
+// 현재 스레드를 막고 task 가 끝나기를 기다려 결과를 돌려 줍니다.
+// (main 처럼 코루틴이 아닌 곳에서 사용합니다)
+template <typename T>
+decltype(auto) sync_wait(Task<T> task) {
+    detail::SyncState state;
+    detail::SyncRunner runner = detail::syncRun(task);
+    runner.handle.promise().state = &state;
+    runner.handle.resume();
+    {
+        std::unique_lock<std::mutex> lock(state.mutex);
+        state.cv.wait(lock, [&] { return state.done; });
+    }
+    if constexpr (std::is_void_v<T>) {
+        task.result();
+    } else {
+        return T(task.result());
+    }
+}
+
+// 모든 Task 가 끝나면 결과를 tuple 로 돌려 줍니다. (void 자리는 std::monostate)
+// 자식은 co_await 한 스레드에서 차례로 시작되므로, 병렬로 돌리려면 자식이
+// schedule() 로 풀에 넘어가야 합니다. 예외가 있으면 앞쪽 자식의 예외를 던집니다.
+template <typename... Ts>
+Task<std::tuple<detail::NonVoid<Ts>...>> when_all(Task<Ts>... tasks) {
+    std::vector<detail::AllRunner> runners;
+    runners.reserve(sizeof...(Ts));
+    (runners.push_back(detail::allRun(tasks)), ...);
+    co_await detail::AllAwaiter(std::move(runners));
+    co_return std::tuple<detail::NonVoid<Ts>...>{detail::takeResult(tasks)...};
+}
+
+// 같은 타입 Task 여러 개. 결과는 입력 순서대로의 vector 입니다. (void 면 결과 없음)
+template <typename T>
+Task<std::conditional_t<std::is_void_v<T>, void, std::vector<detail::NonVoid<T>>>>
+when_all(std::vector<Task<T>> tasks) {
+    std::vector<detail::AllRunner> runners;
+    runners.reserve(tasks.size());
+    for (Task<T> &t : tasks) {
+        runners.push_back(detail::allRun(t));
+    }
+    co_await detail::AllAwaiter(std::move(runners));
+    if constexpr (std::is_void_v<T>) {
+        for (Task<T> &t : tasks) {
+            t.result();
+        }
+    } else {
+        std::vector<T> results;
+        results.reserve(tasks.size());
+        for (Task<T> &t : tasks) {
+            results.push_back(t.result());
+        }
+        co_return results;
+    }
+}
+
+// 가장 먼저 끝난 Task 의 (순번, 결과) 를 돌려 줍니다. (void 면 순번만)
+// 나머지 Task 는 취소되지 않고 끝까지 실행된 뒤 해제됩니다.
+// tasks 는 비어 있으면 안 됩니다.
+template <typename T>
+Task<std::conditional_t<std::is_void_v<T>, size_t, std::pair<size_t, detail::NonVoid<T>>>>
+when_any(std::vector<Task<T>> tasks) {
+    auto state = std::make_shared<detail::AnyState<T>>();
+    state->tasks = std::move(tasks);
+    co_await detail::AnyAwaiter<T>(state);
+    size_t i = state->index;
+    if constexpr (std::is_void_v<T>) {
+        state->tasks[i].result();
+        co_return i;
+    } else {
+        co_return std::pair<size_t, T>{i, state->tasks[i].result()};
+    }
+}
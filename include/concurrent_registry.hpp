@@ -0,0 +1,286 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// ConcurrentRegistry 클래스 정의
+// 이름(문자열)으로 객체를 찾는 동시성 레지스트리입니다.
+//  - 해시의 상위 비트로 샤드를 고르고, 샤드마다 선형 탐사(open addressing) 테이블을 둡니다.
+//  - 조회는 잠금 없이 수행됩니다. 등록/해제는 샤드 단위 뮤텍스로 직렬화됩니다.
+//  - 해제된 항목은 그 시점에 조회 중이던 스레드가 모두 빠져나간 뒤에 삭제합니다.
+//    (샤드별 2-세대 읽기 카운터를 이용한 간단한 RCU)
+//  - std::map::operator[] 처럼 조회 중에 몰래 삽입하는 일은 없습니다.
+// 값은 std::shared_ptr<V> 로 보관하므로 find() 로 받은 객체는 해제된 뒤에도 안전합니다.
+template <typename V, size_t Shards = 16>
+class ConcurrentRegistry {
+    static_assert((Shards & (Shards - 1)) == 0, "Shards must be a power of two");
+
+public:
+    // 미리 해시를 계산해 둔 키. 같은 이름을 반복해서 조회할 때 해시 계산을 생략합니다.
+    // name 이 가리키는 문자열은 Key 를 사용하는 동안 살아 있어야 합니다.
+    struct Key {
+        std::string_view name;
+        uint64_t hash;
+    };
+
+    static Key key(std::string_view name) {
+        return Key{name, std::hash<std::string_view>{}(name)};
+    }
+
+    ConcurrentRegistry() = default;
+    ConcurrentRegistry(const ConcurrentRegistry &) = delete;
+    ConcurrentRegistry &operator=(const ConcurrentRegistry &) = delete;
+
+    ~ConcurrentRegistry() {
+        for (auto &shard : shards_) {
+            Table *table = shard.table.load(std::memory_order_relaxed);
+            if (table == nullptr) {
+                continue;
+            }
+            for (size_t i = 0; i <= table->mask; ++i) {
+                Entry *e = table->slots[i].load(std::memory_order_relaxed);
+                if (e != nullptr && e != tombstone()) {
+                    delete e;
+                }
+            }
+            delete table;
+        }
+    }
+
+    // 등록: 같은 이름이 이미 있으면 덮어쓰지 않고 false 를 반환합니다.
+    bool insert(std::string_view name, std::shared_ptr<V> value) {
+        return insert(key(name), std::move(value));
+    }
+
+    bool insert(Key k, std::shared_ptr<V> value) {
+        Shard &shard = shardOf(k.hash);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        Table *table = shard.table.load(std::memory_order_relaxed);
+        Entry *existing;
+        if (table != nullptr && findSlot(table, k, existing) != nullptr) {
+            return false;
+        }
+        // 툼스톤을 포함해 절반 이상 차면 테이블을 새로 만듭니다.
+        if (table == nullptr || (table->used + 1) * 2 > table->mask + 1) {
+            table = rebuild(shard, table);
+        }
+
+        Entry *entry = new Entry{std::string(k.name), k.hash, std::move(value)};
+        for (size_t i = k.hash & table->mask;; i = (i + 1) & table->mask) {
+            Entry *e = table->slots[i].load(std::memory_order_relaxed);
+            if (e == nullptr || e == tombstone()) {
+                if (e == nullptr) {
+                    ++table->used;
+                }
+                table->slots[i].store(entry, std::memory_order_release);
+                break;
+            }
+        }
+        shard.size.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // 해제: 조회 중인 스레드가 모두 빠져나간 뒤 반환하므로, 반환 후에는
+    // 레지스트리가 해당 값에 대한 참조를 갖고 있지 않습니다.
+    bool erase(std::string_view name) { return erase(key(name)); }
+
+    bool erase(Key k) {
+        Shard &shard = shardOf(k.hash);
+        Entry *removed;
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            Table *table = shard.table.load(std::memory_order_relaxed);
+            std::atomic<Entry *> *slot = table ? findSlot(table, k, removed) : nullptr;
+            if (slot == nullptr) {
+                return false;
+            }
+            slot->store(tombstone(), std::memory_order_release);
+            shard.size.fetch_sub(1, std::memory_order_relaxed);
+            synchronize(shard);
+        }
+        delete removed;
+        return true;
+    }
+
+    // 조회: 잠금 없이 찾아 shared_ptr 을 복사해 돌려줍니다. 없으면 nullptr.
+    std::shared_ptr<V> find(std::string_view name) const { return find(key(name)); }
+
+    std::shared_ptr<V> find(Key k) const {
+        std::shared_ptr<V> result;
+        visit(k, [&result](const std::shared_ptr<V> &value) { result = value; });
+        return result;
+    }
+
+    bool contains(std::string_view name) const { return contains(key(name)); }
+
+    bool contains(Key k) const {
+        return visit(k, [](const std::shared_ptr<V> &) {});
+    }
+
+    // 조회: 찾은 값에 대해 읽기 구간 안에서 f(const std::shared_ptr<V> &) 를 호출합니다.
+    // shared_ptr 복사(참조 카운트 증가)가 필요 없는 짧은 작업에 사용합니다.
+    template <typename F>
+    bool visit(std::string_view name, F &&f) const {
+        return visit(key(name), std::forward<F>(f));
+    }
+
+    template <typename F>
+    bool visit(Key k, F &&f) const {
+        Shard &shard = shardOf(k.hash);
+        ReadGuard guard(shard);
+        Table *table = shard.table.load(std::memory_order_acquire);
+        if (table == nullptr) {
+            return false;
+        }
+        Entry *entry;
+        if (findSlot(table, k, entry) == nullptr) {
+            return false;
+        }
+        f(entry->value);
+        return true;
+    }
+
+    // 모든 항목에 대해 f(std::string_view name, const std::shared_ptr<V> &) 를 호출합니다.
+    // 순회 중에 등록/해제된 항목은 포함될 수도, 빠질 수도 있습니다.
+    template <typename F>
+    void forEach(F &&f) const {
+        for (auto &shard : shards_) {
+            ReadGuard guard(shard);
+            Table *table = shard.table.load(std::memory_order_acquire);
+            if (table == nullptr) {
+                continue;
+            }
+            for (size_t i = 0; i <= table->mask; ++i) {
+                Entry *e = table->slots[i].load(std::memory_order_acquire);
+                if (e != nullptr && e != tombstone()) {
+                    f(std::string_view(e->name), e->value);
+                }
+            }
+        }
+    }
+
+    size_t size() const {
+        size_t total = 0;
+        for (auto &shard : shards_) {
+            total += shard.size.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+private:
+    struct Entry {
+        std::string name;
+        uint64_t hash;
+        std::shared_ptr<V> value;
+    };
+
+    struct Table {
+        explicit Table(size_t capacity)
+            : mask(capacity - 1), slots(new std::atomic<Entry *>[capacity]) {
+            for (size_t i = 0; i < capacity; ++i) {
+                slots[i].store(nullptr, std::memory_order_relaxed);
+            }
+        }
+        size_t mask;
+        std::unique_ptr<std::atomic<Entry *>[]> slots;
+        size_t used = 0;  // 항목 + 툼스톤 수 (샤드 뮤텍스 아래에서만 접근)
+    };
+
+    // 캐시 라인을 나눠 샤드 간 false sharing 을 막습니다.
+    struct alignas(64) Shard {
+        std::mutex mutex;                         // 등록/해제 직렬화
+        std::atomic<Table *> table{nullptr};      // 현재 테이블
+        std::atomic<size_t> size{0};              // 항목 수
+        alignas(64) std::atomic<uint32_t> epoch{0};
+        std::atomic<uint64_t> readers[2] = {};    // 세대별 읽기 중인 스레드 수
+    };
+
+    // 읽기 구간: 현재 세대의 카운터를 올리고, 그 사이 세대가 바뀌었다면 다시 시도합니다.
+    class ReadGuard {
+    public:
+        explicit ReadGuard(Shard &shard) : shard_(shard) {
+            for (;;) {
+                idx_ = shard_.epoch.load() & 1;
+                shard_.readers[idx_].fetch_add(1);
+                if ((shard_.epoch.load() & 1) == idx_) {
+                    break;
+                }
+                shard_.readers[idx_].fetch_sub(1);
+            }
+        }
+        ~ReadGuard() { shard_.readers[idx_].fetch_sub(1, std::memory_order_release); }
+
+    private:
+        Shard &shard_;
+        uint32_t idx_;
+    };
+
+    static Entry *tombstone() { return reinterpret_cast<Entry *>(uintptr_t{1}); }
+
+    // 슬롯 인덱스는 하위 비트를 쓰므로 샤드는 상위 비트로 고릅니다.
+    Shard &shardOf(uint64_t hash) const { return shards_[(hash >> 48) & (Shards - 1)]; }
+
+    // 키가 들어 있는 슬롯을 찾습니다. 찾은 순간의 항목을 entry 에 돌려줍니다.
+    // (슬롯은 그 직후 다른 스레드가 툼스톤으로 바꿀 수 있으므로 다시 읽지 않습니다.)
+    static std::atomic<Entry *> *findSlot(Table *table, Key k, Entry *&entry) {
+        for (size_t i = k.hash & table->mask;; i = (i + 1) & table->mask) {
+            Entry *e = table->slots[i].load(std::memory_order_acquire);
+            if (e == nullptr) {
+                return nullptr;
+            }
+            if (e != tombstone() && e->hash == k.hash && e->name == k.name) {
+                entry = e;
+                return &table->slots[i];
+            }
+        }
+    }
+
+    // 샤드 뮤텍스를 잡은 상태에서 호출합니다.
+    // 세대를 넘긴 뒤, 이전 세대에서 시작한 읽기가 모두 끝날 때까지 기다립니다.
+    static void synchronize(Shard &shard) {
+        uint32_t old = shard.epoch.fetch_add(1) & 1;
+        while (shard.readers[old].load() != 0) {
+            std::this_thread::yield();
+        }
+    }
+
+    // 샤드 뮤텍스를 잡은 상태에서 호출합니다. 툼스톤을 걷어내고 필요하면 크기를 늘립니다.
+    Table *rebuild(Shard &shard, Table *old) {
+        size_t live = shard.size.load(std::memory_order_relaxed) + 1;
+        size_t capacity = 16;
+        while (capacity < live * 4) {
+            capacity <<= 1;
+        }
+        Table *table = new Table(capacity);
+        if (old != nullptr) {
+            for (size_t i = 0; i <= old->mask; ++i) {
+                Entry *e = old->slots[i].load(std::memory_order_relaxed);
+                if (e == nullptr || e == tombstone()) {
+                    continue;
+                }
+                size_t j = e->hash & table->mask;
+                while (table->slots[j].load(std::memory_order_relaxed) != nullptr) {
+                    j = (j + 1) & table->mask;
+                }
+                table->slots[j].store(e, std::memory_order_relaxed);
+                ++table->used;
+            }
+        }
+        shard.table.store(table, std::memory_order_release);
+        if (old != nullptr) {
+            synchronize(shard);
+            delete old;
+        }
+        return table;
+    }
+
+    mutable Shard shards_[Shards];
+};
@@ -0,0 +1,513 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// LatencyHistogram 클래스 정의
+// HdrHistogram 과 같은 로그-선형 구간의 나노초 히스토그램입니다.
+//  - 0~31 ns 는 1 ns 단위, 그 위로는 2 의 거듭제곱 구간마다 16 칸 (상대 오차 1/16 이하)
+//  - 2^40 ns (약 18 분) 이상은 마지막 칸에 모읍니다.
+// 잠금이 없으므로 한 번에 한 스레드만 기록해야 합니다. (JobMetricsRegistry 가 보장)
+class LatencyHistogram {
+public:
+    static constexpr int kLinearBits = 5;
+    static constexpr int kSubBits = 4;
+    static constexpr int kMaxBits = 40;
+    static constexpr size_t kBuckets =
+        (size_t{1} << kLinearBits) + (kMaxBits - kLinearBits) * (size_t{1} << kSubBits);
+
+    void record(uint64_t ns) {
+        if (counts_.empty()) {
+            counts_.resize(kBuckets);
+        }
+        ++counts_[index(ns)];
+        ++count_;
+        sum_ += ns;
+        max_ = std::max(max_, ns);
+    }
+
+    uint64_t count() const { return count_; }
+    uint64_t sum() const { return sum_; }
+    uint64_t max() const { return max_; }
+
+    // q (0~1) 분위수. 그 값이 속한 칸의 상한을 돌려줍니다.
+    uint64_t quantile(double q) const {
+        if (count_ == 0) {
+            return 0;
+        }
+        uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(count_ - 1)) + 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts_.size(); ++i) {
+            seen += counts_[i];
+            if (seen >= rank) {
+                return std::min(upper(i), max_);
+            }
+        }
+        return max_;
+    }
+
+    // limit 이하로 기록된 값의 수. 칸 하나가 limit 에 걸쳐 있으면 그 칸을 포함합니다.
+    uint64_t countAtMost(uint64_t limit) const {
+        uint64_t n = 0;
+        for (size_t i = 0; i < counts_.size() && lower(i) <= limit; ++i) {
+            n += counts_[i];
+        }
+        return n;
+    }
+
+private:
+    static size_t index(uint64_t v) {
+        if (v < (uint64_t{1} << kLinearBits)) {
+            return static_cast<size_t>(v);
+        }
+        int msb = 63 - __builtin_clzll(v);
+        if (msb >= kMaxBits) {
+            return kBuckets - 1;
+        }
+        int shift = msb - kSubBits;
+        uint64_t sub = (v >> shift) - (uint64_t{1} << kSubBits);
+        return (size_t{1} << kLinearBits) +
+               static_cast<size_t>(msb - kLinearBits) * (size_t{1} << kSubBits) +
+               static_cast<size_t>(sub);
+    }
+
+    static uint64_t lower(size_t i) {
+        if (i < (size_t{1} << kLinearBits)) {
+            return i;
+        }
+        size_t j = i - (size_t{1} << kLinearBits);
+        int shift = static_cast<int>(j >> kSubBits) + kLinearBits - kSubBits;
+        uint64_t sub = (j & ((size_t{1} << kSubBits) - 1)) + (uint64_t{1} << kSubBits);
+        return sub << shift;
+    }
+
+    static uint64_t upper(size_t i) {
+        return i + 1 < kBuckets ? lower(i + 1) - 1 : UINT64_MAX;
+    }
+
+    std::vector<uint64_t> counts_;  // 처음 기록할 때 kBuckets 칸을 만듭니다.
+    uint64_t count_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t max_ = 0;
+};
+
+class JobMetricsRegistry;
+
+// JobMetrics 클래스 정의
+// 작업 하나의 기록용 핸들입니다. 기록은 호출한 스레드의 버퍼에 이벤트를 하나 넣는
+// 것뿐이라 잠금도, 공유 캐시 라인에 대한 쓰기도 없습니다.
+// 같은 이름의 핸들이 모두 사라지면 그 작업은 다음 집계부터 출력에서 빠집니다.
+class JobMetrics {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    JobMetrics() = default;
+    JobMetrics(JobMetrics &&other) noexcept
+        : id_(std::exchange(other.id_, kNone)), generation_(other.generation_) {}
+    JobMetrics &operator=(JobMetrics &&other) noexcept {
+        if (this != &other) {
+            retire();
+            id_ = std::exchange(other.id_, kNone);
+            generation_ = other.generation_;
+        }
+        return *this;
+    }
+    JobMetrics(const JobMetrics &) = delete;
+    JobMetrics &operator=(const JobMetrics &) = delete;
+    ~JobMetrics() { retire(); }
+
+    bool valid() const { return id_ != kNone; }
+
+    // 한 번 실행. wakeup 은 실행되어야 했던 시각(알림, 예정 시각)부터 실제 시작까지,
+    // overrun 은 실행이 주기보다 길었는지 여부입니다.
+    inline void recordRun(Clock::duration run, Clock::duration wakeup, bool overrun = false) const;
+    // 앞선 실행이 끝나지 않아 건너뛴 주기
+    inline void recordSkipped() const;
+    // 일시 중지되어 있던 시간
+    inline void recordPaused(Clock::duration paused) const;
+    // 실행 외의 이유로 기한을 넘긴 경우 (예: Join 시간 초과)
+    inline void recordOverrun() const;
+
+private:
+    friend class JobMetricsRegistry;
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    JobMetrics(uint32_t id, uint32_t generation) : id_(id), generation_(generation) {}
+    inline void retire();
+
+    uint32_t id_ = kNone;
+    uint32_t generation_ = 0;  // id_ 칸을 다시 쓸 때마다 올라갑니다.
+};
+
+// JobMetricsRegistry 클래스 정의
+// 작업별 지표를 모아 Prometheus 텍스트 형식으로 내보냅니다.
+//  - 스레드마다 단일 생산자 링 버퍼를 두고, 기록은 그 버퍼에 이벤트를 넣기만 합니다.
+//  - 집계(snapshot/prometheus)할 때 모든 버퍼를 비우면서 작업별 누적값에 반영합니다.
+//    버퍼가 가득 차면 기록하던 스레드가 자신의 버퍼를 직접 비웁니다. (드묾)
+//  - 같은 이름은 한 칸(시계열)을 함께 씁니다. 마지막 핸들이 사라진 칸은 다시 쓰되
+//    세대 번호를 올리므로, 작업이 사라진 뒤에 도착한 이벤트는 버려집니다.
+// 프로세스 전체에서 하나(global())만 씁니다. 워커 스레드가 정적 객체 소멸 이후에
+// 끝날 수 있으므로 일부러 해제하지 않습니다.
+class JobMetricsRegistry {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct JobSnapshot {
+        std::string name;
+        uint64_t runs = 0;
+        uint64_t overruns = 0;
+        uint64_t skipped = 0;
+        uint64_t paused_ns = 0;
+        LatencyHistogram run;
+        LatencyHistogram wakeup;
+    };
+
+    static JobMetricsRegistry &global() {
+        static JobMetricsRegistry *registry = new JobMetricsRegistry();
+        return *registry;
+    }
+
+    // name 은 Prometheus 의 job 레이블 값이 됩니다. 이미 살아 있는 이름이면 그 작업의
+    // 누적값에 함께 기록하므로, 출력에 같은 레이블의 시계열이 두 번 나오지 않습니다.
+    JobMetrics add(std::string name) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = byName_.find(name);
+        if (it != byName_.end()) {
+            Job &job = jobs_[it->second];
+            ++job.refs;
+            return JobMetrics(it->second, job.generation);
+        }
+
+        uint32_t id;
+        if (!free_.empty()) {
+            id = free_.back();
+            free_.pop_back();
+        } else {
+            id = static_cast<uint32_t>(jobs_.size());
+            jobs_.emplace_back();
+        }
+        Job &job = jobs_[id];
+        job.name = std::move(name);
+        job.refs = 1;
+        byName_.emplace(job.name, id);
+        return JobMetrics(id, job.generation);
+    }
+
+    // 모든 버퍼를 비운 뒤 살아 있는 작업들의 누적값을 복사해 돌려줍니다.
+    std::vector<JobSnapshot> snapshot() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        drainAllLocked();
+        std::vector<JobSnapshot> out;
+        for (const Job &job : jobs_) {
+            if (job.refs > 0) {
+                out.push_back(job.stats);
+                out.back().name = job.name;
+            }
+        }
+        return out;
+    }
+
+    // Prometheus text exposition format (version 0.0.4)
+    std::string prometheus() {
+        std::vector<JobSnapshot> jobs = snapshot();
+        std::string out;
+        out.reserve(256 + jobs.size() * 3072);
+
+        counter(out, jobs, "thread_job_runs_total", "Completed runs per job.",
+                [](const JobSnapshot &j) { return static_cast<double>(j.runs); });
+        counter(out, jobs, "thread_job_overruns_total",
+                "Runs that took longer than their period, and missed deadlines.",
+                [](const JobSnapshot &j) { return static_cast<double>(j.overruns); });
+        counter(out, jobs, "thread_job_skipped_total",
+                "Runs skipped because earlier work was still executing.",
+                [](const JobSnapshot &j) { return static_cast<double>(j.skipped); });
+        counter(out, jobs, "thread_job_paused_seconds_total", "Time spent paused.",
+                [](const JobSnapshot &j) { return static_cast<double>(j.paused_ns) * 1e-9; });
+        histogram(out, jobs, "thread_job_run_duration_seconds", "Wall time of each run.",
+                  &JobSnapshot::run);
+        histogram(out, jobs, "thread_job_wakeup_latency_seconds",
+                  "Delay from when a run was due (notify or timer expiry) to when it started.",
+                  &JobSnapshot::wakeup);
+        return out;
+    }
+
+private:
+    friend class JobMetrics;
+
+    enum class Kind : uint8_t { Run, RunOverrun, Skipped, Paused, Overrun };
+
+    struct Event {
+        uint32_t job;
+        uint32_t generation;
+        Kind kind;
+        uint64_t a;  // Run: 실행 시간, Paused: 중지 시간 (ns)
+        uint64_t b;  // Run: 깨어나기까지의 지연 (ns)
+    };
+
+    // 한 스레드의 링 버퍼. tail 은 그 스레드만, head 는 mutex_ 를 잡은 쪽만 씁니다.
+    struct Buffer {
+        static constexpr size_t kCapacity = 4096;
+        Event events[kCapacity];
+        std::atomic<uint64_t> head{0};
+        std::atomic<uint64_t> tail{0};
+    };
+
+    struct Job {
+        std::string name;
+        uint32_t generation = 0;
+        uint32_t refs = 0;  // 이 칸을 쓰는 핸들 수. 0 이면 빈 칸입니다.
+        JobSnapshot stats;
+    };
+
+    // 스레드가 끝날 때 남은 이벤트를 반영하고 버퍼를 거둡니다.
+    struct BufferOwner {
+        JobMetricsRegistry *registry = nullptr;
+        Buffer *buffer = nullptr;
+
+        ~BufferOwner() {
+            if (buffer != nullptr) {
+                registry->release(buffer);
+            }
+        }
+    };
+
+    JobMetricsRegistry() = default;
+
+    Buffer &local() {
+        thread_local BufferOwner owner;
+        if (owner.buffer == nullptr) {
+            auto buffer = std::make_unique<Buffer>();
+            std::lock_guard<std::mutex> lock(mutex_);
+            buffers_.push_back(std::move(buffer));
+            owner.registry = this;
+            owner.buffer = buffers_.back().get();
+        }
+        return *owner.buffer;
+    }
+
+    void push(const Event &e) {
+        Buffer &b = local();
+        uint64_t tail = b.tail.load(std::memory_order_relaxed);
+        if (tail - b.head.load(std::memory_order_acquire) == Buffer::kCapacity) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            drainLocked(b);
+        }
+        b.events[tail % Buffer::kCapacity] = e;
+        b.tail.store(tail + 1, std::memory_order_release);
+    }
+
+    void drainLocked(Buffer &b) {
+        uint64_t head = b.head.load(std::memory_order_relaxed);
+        uint64_t tail = b.tail.load(std::memory_order_acquire);
+        for (; head != tail; ++head) {
+            apply(b.events[head % Buffer::kCapacity]);
+        }
+        b.head.store(head, std::memory_order_release);
+    }
+
+    void drainAllLocked() {
+        for (auto &b : buffers_) {
+            drainLocked(*b);
+        }
+    }
+
+    void apply(const Event &e) {
+        Job &job = jobs_[e.job];
+        if (job.refs == 0 || job.generation != e.generation) {
+            return;
+        }
+        JobSnapshot &s = job.stats;
+        switch (e.kind) {
+        case Kind::RunOverrun:
+            ++s.overruns;
+            [[fallthrough]];
+        case Kind::Run:
+            ++s.runs;
+            s.run.record(e.a);
+            s.wakeup.record(e.b);
+            break;
+        case Kind::Skipped:
+            ++s.skipped;
+            break;
+        case Kind::Paused:
+            s.paused_ns += e.a;
+            break;
+        case Kind::Overrun:
+            ++s.overruns;
+            break;
+        }
+    }
+
+    void retire(uint32_t id, uint32_t generation) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Job &job = jobs_[id];
+        if (job.generation != generation || --job.refs > 0) {
+            return;
+        }
+        // 마지막 핸들이면 칸을 비웁니다. 세대가 바뀌므로 그때까지 쌓인 이벤트는
+        // 버려지고, 누적값의 메모리도 돌려줍니다.
+        byName_.erase(job.name);
+        job.name = std::string();
+        job.stats = JobSnapshot();
+        ++job.generation;
+        free_.push_back(id);
+    }
+
+    void release(Buffer *buffer) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        drainLocked(*buffer);
+        buffers_.erase(std::find_if(buffers_.begin(), buffers_.end(),
+                                    [buffer](const auto &b) { return b.get() == buffer; }));
+    }
+
+    static uint64_t toNs(Clock::duration d) {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+        return ns < 0 ? 0 : static_cast<uint64_t>(ns);
+    }
+
+    // 레이블 값의 \, ", 줄바꿈을 이스케이프합니다.
+    static void label(std::string &out, const std::string &value) {
+        out += "job=\"";
+        for (char c : value) {
+            if (c == '\\' || c == '"') {
+                out += '\\';
+                out += c;
+            } else if (c == '\n') {
+                out += "\\n";
+            } else {
+                out += c;
+            }
+        }
+        out += '"';
+    }
+
+    static void number(std::string &out, double v) {
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "%.9g", v);
+        out += buf;
+    }
+
+    static void header(std::string &out, const char *name, const char *help, const char *type) {
+        out += "# HELP ";
+        out += name;
+        out += ' ';
+        out += help;
+        out += "\n# TYPE ";
+        out += name;
+        out += ' ';
+        out += type;
+        out += '\n';
+    }
+
+    template <typename Value>
+    static void counter(std::string &out, const std::vector<JobSnapshot> &jobs, const char *name,
+                        const char *help, Value value) {
+        header(out, name, help, "counter");
+        for (const JobSnapshot &j : jobs) {
+            out += name;
+            out += '{';
+            label(out, j.name);
+            out += "} ";
+            number(out, value(j));
+            out += '\n';
+        }
+    }
+
+    // 고정 경계(1us ~ 10s, 1-2.5-5 단계)의 누적 버킷으로 내보냅니다.
+    static void histogram(std::string &out, const std::vector<JobSnapshot> &jobs,
+                          const char *name, const char *help,
+                          LatencyHistogram JobSnapshot::*member) {
+        static const double kBounds[] = {1e-6,   2.5e-6, 5e-6,   1e-5, 2.5e-5, 5e-5, 1e-4, 2.5e-4,
+                                         5e-4,   1e-3,   2.5e-3, 5e-3, 1e-2,   2.5e-2, 5e-2, 0.1,
+                                         0.25,   0.5,    1,      2.5,  5,      10};
+        header(out, name, help, "histogram");
+        for (const JobSnapshot &j : jobs) {
+            const LatencyHistogram &h = j.*member;
+            for (double le : kBounds) {
+                out += name;
+                out += "_bucket{";
+                label(out, j.name);
+                out += ",le=\"";
+                number(out, le);
+                out += "\"} ";
+                number(out, static_cast<double>(
+                                h.countAtMost(static_cast<uint64_t>(le * 1e9 + 0.5))));
+                out += '\n';
+            }
+            out += name;
+            out += "_bucket{";
+            label(out, j.name);
+            out += ",le=\"+Inf\"} ";
+            number(out, static_cast<double>(h.count()));
+            out += '\n';
+            out += name;
+            out += "_sum{";
+            label(out, j.name);
+            out += "} ";
+            number(out, static_cast<double>(h.sum()) * 1e-9);
+            out += '\n';
+            out += name;
+            out += "_count{";
+            label(out, j.name);
+            out += "} ";
+            number(out, static_cast<double>(h.count()));
+            out += '\n';
+        }
+    }
+
+    std::mutex mutex_;
+    std::deque<Job> jobs_;                         // 작업 id 로 찾습니다.
+    std::vector<uint32_t> free_;                   // 다시 쓸 빈 칸
+    std::unordered_map<std::string, uint32_t> byName_;  // 살아 있는 칸의 이름
+    std::vector<std::unique_ptr<Buffer>> buffers_;  // 살아 있는 스레드의 버퍼
+};
+
+inline void JobMetrics::recordRun(Clock::duration run, Clock::duration wakeup,
+                                  bool overrun) const {
+    if (id_ == kNone) {
+        return;
+    }
+    using R = JobMetricsRegistry;
+    R::global().push(R::Event{id_, generation_, overrun ? R::Kind::RunOverrun : R::Kind::Run,
+                              R::toNs(run), R::toNs(wakeup)});
+}
+
+inline void JobMetrics::recordSkipped() const {
+    if (id_ != kNone) {
+        JobMetricsRegistry::global().push(
+            JobMetricsRegistry::Event{id_, generation_, JobMetricsRegistry::Kind::Skipped, 0, 0});
+    }
+}
+
+inline void JobMetrics::recordPaused(Clock::duration paused) const {
+    if (id_ != kNone) {
+        JobMetricsRegistry::global().push(
+            JobMetricsRegistry::Event{id_, generation_, JobMetricsRegistry::Kind::Paused,
+                                      JobMetricsRegistry::toNs(paused), 0});
+    }
+}
+
+inline void JobMetrics::recordOverrun() const {
+    if (id_ != kNone) {
+        JobMetricsRegistry::global().push(
+            JobMetricsRegistry::Event{id_, generation_, JobMetricsRegistry::Kind::Overrun, 0, 0});
+    }
+}
+
+inline void JobMetrics::retire() {
+    if (id_ != kNone) {
+        JobMetricsRegistry::global().retire(id_, generation_);
+        id_ = kNone;
+    }
+}
@@ -1,74 +1,573 @@
 #include <arpa/inet.h>
+#include <chrono>
 #include <cstring>
 #include <iostream>
 #include <net/if.h>
 #include <netinet/in.h>
+#include <random>
 #include <sys/socket.h>
+#include <thread>
+#include <vector>
 
+#include "ip_prefix.hpp"
+#include "ipv4_text.hpp"
+#include "lpm_table.hpp"
+
+// Parses both strings on every call; for many addresses against the same
+// network, parse a Prefix once and use Prefix::contains.
 bool check_ipv6_network(const char *ipv6_address_str,
                         const char *network_address_str, int netmask_len) {
-    // Create a socket address structure for the IPv6 address
-    struct sockaddr_in6 ipv6_address;
-    std::memset(&ipv6_address, 0, sizeof(ipv6_address));
-    ipv6_address.sin6_family = AF_INET6;
-    if (inet_pton(AF_INET6, ipv6_address_str, &ipv6_address.sin6_addr) != 1) {
+    Address address;
+    if (!Address::parse(ipv6_address_str, address)) {
         std::cerr << "Invalid IPv6 address: " << ipv6_address_str << std::endl;
         return false;
     }
 
-    // Create a socket address structure for the network address
-    struct sockaddr_in6 network_address;
-    std::memset(&network_address, 0, sizeof(network_address));
-    network_address.sin6_family = AF_INET6;
-    if (inet_pton(AF_INET6, network_address_str, &network_address.sin6_addr) !=
-        1) {
+    Address network;
+    int family;
+    if (!Address::parse(network_address_str, network, &family)) {
         std::cerr << "Invalid network address: " << network_address_str
                   << std::endl;
         return false;
     }
+    if (netmask_len < 0 || netmask_len > (family == AF_INET ? 32 : 128)) {
+        std::cerr << "Invalid netmask length: " << netmask_len << std::endl;
+        return false;
+    }
 
-    // Apply the netmask to the network address
-    for (int i = 0; i < netmask_len; i++) {
-        int byte_index = i / 8;
-        int bit_index = i % 8;
-        network_address.sin6_addr.s6_addr[byte_index] &=
-            ~(1 << (7 - bit_index));
+    return Prefix(network, netmask_len, family).contains(address);
+}
+
+std::string getNetwork(const std::string ip_addr_str,
+                       const std::string netmask_str) {
+    uint32_t ip_addr, netmask;
+    if (!IPv4Text::parse(ip_addr_str.data(), ip_addr_str.size(), ip_addr) ||
+        !IPv4Text::parse(netmask_str.data(), netmask_str.size(), netmask)) {
+        std::cerr << "Invalid IPv4 address or netmask: " << ip_addr_str << " "
+                  << netmask_str << std::endl;
+        return "0.0.0.0";
     }
 
-    // Compare the masked IPv6 address to the masked network address
-    for (int i = 0; i < 16; i++) {
-        if (ipv6_address.sin6_addr.s6_addr[i] !=
-            network_address.sin6_addr.s6_addr[i]) {
+    char network_addr_str[IPv4Text::kMaxLine];
+    return std::string(network_addr_str,
+                       IPv4Text::format(ip_addr & netmask, network_addr_str));
+}
+
+// Membership the slow, obvious way: compare the first `length` bits one by
+// one.
+static bool containsBitwise(const in6_addr &addr, const in6_addr &network,
+                            int length) {
+    for (int i = 0; i < length; i++) {
+        int bit = 7 - i % 8;
+        if (((addr.s6_addr[i / 8] >> bit) & 1) !=
+            ((network.s6_addr[i / 8] >> bit) & 1))
             return false;
+    }
+    return true;
+}
+
+// Prefix against containsBitwise for every length, on addresses that share
+// a random number of leading bits with the network, and the batch API
+// against the single one.
+static bool checkPrefixes() {
+    std::mt19937_64 rng(1);
+    // The second pass puts every network in the IPv4-mapped range, where
+    // an IPv6 length must not be read as an IPv4 one.
+    for (int pass = 0; pass < 2 * 129; ++pass) {
+        int length = pass % 129;
+        in6_addr net;
+        for (auto &byte : net.s6_addr) {
+            byte = static_cast<uint8_t>(rng());
         }
+        if (pass > 128) {
+            std::memset(net.s6_addr, 0, 10);
+            net.s6_addr[10] = net.s6_addr[11] = 0xff;
+        }
+        Prefix prefix(Address::fromV6(net), length, AF_INET6);
+
+        std::vector<in6_addr> raw(1000);
+        std::vector<Address> addrs;
+        for (in6_addr &a : raw) {
+            // Copy the network's first n bits, then flip bit n.
+            int n = static_cast<int>(rng() % 129);
+            for (auto &byte : a.s6_addr) {
+                byte = static_cast<uint8_t>(rng());
+            }
+            for (int i = 0; i < n; ++i) {
+                uint8_t bit = static_cast<uint8_t>(1 << (7 - i % 8));
+                a.s6_addr[i / 8] = static_cast<uint8_t>(
+                    (a.s6_addr[i / 8] & ~bit) | (net.s6_addr[i / 8] & bit));
+            }
+            if (n < 128) {
+                uint8_t bit = static_cast<uint8_t>(1 << (7 - n % 8));
+                a.s6_addr[n / 8] = static_cast<uint8_t>(
+                    (a.s6_addr[n / 8] & ~bit) | (~net.s6_addr[n / 8] & bit));
+            }
+            addrs.push_back(Address::fromV6(a));
+        }
+
+        AddressBits bits = prefix.contains(addrs);
+        for (size_t i = 0; i < raw.size(); ++i) {
+            bool want = containsBitwise(raw[i], net, length);
+            if (prefix.contains(addrs[i]) != want || bits.test(i) != want) {
+                std::cerr << "Prefix disagrees at /" << length << " for "
+                          << addrs[i].toString() << std::endl;
+                return false;
+            }
+        }
+    }
+
+    // IPv4 lengths map onto 96..128.
+    Prefix v4;
+    Address inside, outside;
+    if (!Prefix::parse("192.168.1.0/24", v4) ||
+        !Address::parse("192.168.1.100", inside) ||
+        !Address::parse("192.168.2.1", outside) || !v4.contains(inside) ||
+        v4.contains(outside) || v4.toString() != "192.168.1.0/24") {
+        std::cerr << "IPv4 prefix check failed" << std::endl;
+        return false;
     }
 
+    // IPv6 text in the mapped range keeps IPv6 lengths.
+    Prefix mapped, mapped104, mapped8;
+    Address ten, eleven, loopback6;
+    if (!Prefix::parse("::ffff:0:0/96", mapped) ||
+        !Prefix::parse("::ffff:10.0.0.0/104", mapped104) ||
+        !Prefix::parse("::ffff:10.0.0.0/8", mapped8) ||
+        Prefix::parse("10.0.0.0/104", v4) ||
+        !Address::parse("10.1.2.3", ten) ||
+        !Address::parse("11.0.0.1", eleven) ||
+        !Address::parse("::1", loopback6) || mapped.isV4() ||
+        !mapped.contains(ten) || mapped.contains(loopback6) ||
+        mapped.toString() != "::ffff:0.0.0.0/96" ||
+        !mapped104.contains(ten) || mapped104.contains(eleven) ||
+        mapped104.length() != 104 || mapped8.length() != 8 ||
+        !mapped8.contains(loopback6) ||
+        !check_ipv6_network("::ffff:192.0.2.1", "::ffff:0:0", 96) ||
+        !check_ipv6_network("192.0.2.1", "::ffff:192.0.2.0", 120) ||
+        check_ipv6_network("192.0.3.1", "::ffff:192.0.2.0", 120)) {
+        std::cerr << "IPv4-mapped prefix check failed" << std::endl;
+        return false;
+    }
+    std::cout << "Prefix agrees with the bitwise check for /0 to /128"
+              << std::endl;
     return true;
 }
 
-std::string getNetwork(const std::string ip_addr_str,
-                       const std::string netmask_str) {
-    try {
-        // Convert the IP address and netmask from string format to binary
-        // format
-        in_addr_t ip_addr = inet_addr(ip_addr_str.c_str());
-        in_addr_t netmask = inet_addr(netmask_str.c_str());
-
-        // Perform a bitwise AND operation between the IP address and the
-        // netmask
-        in_addr_t network_addr = ip_addr & netmask;
-
-        // Convert the network address from binary format to string format
-        char network_addr_str[INET_ADDRSTRLEN];
-        inet_ntop(AF_INET, &network_addr, network_addr_str, INET_ADDRSTRLEN);
-        return network_addr_str;
-    } catch (const std::exception &e) {
-        std::cerr << e.what() << '\n';
-    }
-    return "0.0.0.0";
+// Addresses per second against one ACL prefix: strings parsed per call, as
+// check_ipv6_network does, against a Prefix parsed once and the batch API.
+static void benchPrefix() {
+    using Clock = std::chrono::steady_clock;
+    std::mt19937_64 rng(2);
+    std::vector<Address> addrs(1 << 20);
+    std::vector<std::string> texts;
+    for (Address &a : addrs) {  // about half inside 2001:db8::/112
+        a.hi = 0x20010db800000000ULL;
+        a.lo = rng() & ((rng() & 1) != 0 ? 0xffff : ~0ULL);
+    }
+    for (size_t i = 0; i < 100000; ++i) {
+        texts.push_back(addrs[i].toString());
+    }
+
+    size_t hits = 0;
+    auto start = Clock::now();
+    for (const std::string &text : texts)
+        hits += check_ipv6_network(text.c_str(), "2001:db8::", 112);
+    double strings = std::chrono::duration<double>(Clock::now() - start).count() /
+                     static_cast<double>(texts.size());
+
+    Prefix prefix;
+    Prefix::parse("2001:db8::/112", prefix);
+    start = Clock::now();
+    constexpr int kRounds = 20;
+    for (int r = 0; r < kRounds; ++r) {
+        hits += prefix.contains(addrs).count();
+    }
+    double batch = std::chrono::duration<double>(Clock::now() - start).count() /
+                   static_cast<double>(kRounds * addrs.size());
+
+    std::cout << "check_ipv6_network: " << strings * 1e9 << " ns/address, "
+              << "Prefix::contains batch: " << batch * 1e9
+              << " ns/address (hits " << hits << ")" << std::endl;
+}
+
+// Longest match by trying every route, as a caller of check_ipv6_network
+// would, but on pre-parsed prefixes. Ties go to the later route.
+static uint32_t lpmLinear(const std::vector<LpmTable::Route> &routes,
+                          const Address &a) {
+    uint32_t best = LpmTable::kNoMatch;
+    int best_length = -1;
+    for (const LpmTable::Route &r : routes) {
+        int length = r.prefix.bits();
+        if (length >= best_length && r.prefix.contains(a)) {
+            best = r.value;
+            best_length = length;
+        }
+    }
+    return best;
+}
+
+// Routes shaped roughly like a full table: mostly IPv4 /24s above shorter
+// aggregates, IPv6 /32 to /64 under 2000::/3. `hosts` gets addresses inside
+// random routes and `misses` gets random ones.
+static void makeRoutes(size_t v4_count, size_t v6_count, std::mt19937_64 &rng,
+                       std::vector<LpmTable::Route> &routes) {
+    for (size_t i = 0; i < v4_count; ++i) {
+        uint64_t r = rng();
+        int length = r % 10 < 6 ? 24 : static_cast<int>(8 + (r >> 8) % 25);
+        routes.push_back(
+            {Prefix(Address::fromV4(static_cast<uint32_t>(r >> 32)), length,
+                    AF_INET),
+             static_cast<uint32_t>(routes.size())});
+    }
+    for (size_t i = 0; i < v6_count; ++i) {
+        uint64_t r = rng();
+        Address a{(0x2ULL << 60) | (r >> 4), rng()};
+        int length = 32 + static_cast<int>(rng() % 33);
+        routes.push_back(
+            {Prefix(a, length, AF_INET6), static_cast<uint32_t>(routes.size())});
+    }
+}
+
+static std::vector<Address> makeLookups(
+    const std::vector<LpmTable::Route> &routes, size_t count,
+    std::mt19937_64 &rng) {
+    std::vector<Address> addrs;
+    for (size_t i = 0; i < count; ++i) {
+        const Prefix &p = routes[rng() % routes.size()].prefix;
+        Address a = p.network();
+        if (i % 4 == 3) {  // anywhere at all
+            a = p.isV4() ? Address::fromV4(static_cast<uint32_t>(rng()))
+                         : Address{rng(), rng()};
+        } else {  // inside the route, random host bits
+            a.hi |= ~p.mask().hi & rng();
+            a.lo |= ~p.mask().lo & (p.isV4() ? rng() & 0xffffffffULL : rng());
+        }
+        addrs.push_back(a);
+    }
+    return addrs;
 }
 
-int main() {
+// LpmTable against lpmLinear: a dense small set with every length, default
+// routes and duplicates, then with `full` a large one (600k routes).
+static bool checkLpm(bool full) {
+    std::mt19937_64 rng(3);
+    std::vector<LpmTable::Route> routes;
+    for (int i = 0; i < 3000; ++i) {
+        uint64_t r = rng();
+        bool v4 = r & 1;
+        // Few distinct top bits, so prefixes nest and collide.
+        Address a = v4 ? Address::fromV4(static_cast<uint32_t>(rng() & 0xc0ff00ff))
+                       : Address{rng() & 0xc0ff0000000000ffULL, rng() & 0xff};
+        int length = static_cast<int>((r >> 8) % (v4 ? 33 : 129));
+        routes.push_back(
+            {Prefix(a, length, v4 ? AF_INET : AF_INET6), static_cast<uint32_t>(i)});
+    }
+    Prefix any;
+    Prefix::parse("::/0", any);
+    routes.push_back({any, 100000});
+    routes.push_back({routes[10].prefix, 100001});
+    // IPv6 routes in the mapped range, which also serve IPv4 addresses.
+    uint32_t value = 100002;
+    for (const char *text : {"::ffff:0:0/96", "::ffff:192.255.0.0/104",
+                             "::ffff:192.255.0.0/112", "::ffff:c0ff:ff:0/120",
+                             "::ffff:0:0/95"}) {
+        Prefix p;
+        Prefix::parse(text, p);
+        routes.push_back({p, value++});
+    }
+
+    auto check = [&](const std::vector<Address> &addrs) {
+        LpmTable table(routes);
+        for (const Address &a : addrs) {
+            uint32_t want = lpmLinear(routes, a), got = table.lookup(a);
+            if (got != want) {
+                std::cerr << "LpmTable disagrees for " << a.toString()
+                          << ": " << got << " vs " << want << std::endl;
+                return false;
+            }
+        }
+        return true;
+    };
+    if (!check(makeLookups(routes, 20000, rng)))
+        return false;
+
+    if (full) {
+        routes.clear();
+        makeRoutes(500000, 100000, rng, routes);
+        if (!check(makeLookups(routes, 300, rng)))
+            return false;
+    }
+    std::cout << "LpmTable agrees with a linear scan" << std::endl;
+    return true;
+}
+
+// 500k IPv4 and 100k IPv6 routes: LpmTable lookups, a linear scan over
+// pre-parsed prefixes, and check_ipv6_network over the IPv6 routes as text.
+// Meanwhile a reader thread keeps looking up while the table is reloaded.
+static void benchLpm() {
+    using Clock = std::chrono::steady_clock;
+    auto seconds = [](Clock::time_point start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    };
+    std::mt19937_64 rng(4);
+    std::vector<LpmTable::Route> routes;
+    makeRoutes(500000, 100000, rng, routes);
+
+    auto start = Clock::now();
+    auto table = std::make_unique<LpmTable>(routes);
+    double build = seconds(start);
+    size_t memory = table->memoryBytes();
+    SharedLpmTable shared(std::move(table));
+
+    // A few thousand addresses stay in cache with the nodes they reach, as
+    // with real, skewed traffic; a million random ones miss on every level.
+    std::vector<Address> addrs = makeLookups(routes, 1 << 20, rng);
+    std::vector<uint32_t> out(addrs.size());
+    size_t hits = 0;
+    auto timeLookups = [&](std::span<const Address> batch) {
+        size_t rounds = (size_t{16} << 20) / batch.size();
+        auto t0 = Clock::now();
+        for (size_t r = 0; r < rounds; ++r) {
+            shared.read()->lookup(batch, out.data());
+            hits += out[r % batch.size()];
+        }
+        return seconds(t0) / static_cast<double>(rounds * batch.size());
+    };
+    double hot = timeLookups(std::span(addrs).first(4096));
+    double cold = timeLookups(addrs);
+
+    start = Clock::now();
+    for (size_t i = 0; i < 100; ++i) {
+        hits += lpmLinear(routes, addrs[i]);
+    }
+    double linear = seconds(start) / 100;
+
+    std::vector<std::pair<std::string, int>> v6_text;
+    for (const LpmTable::Route &r : routes) {
+        if (!r.prefix.isV4())
+            v6_text.emplace_back(r.prefix.network().toString(),
+                                 r.prefix.length());
+    }
+    std::string target = Address{0x2ULL << 60, 1}.toString();
+    start = Clock::now();
+    for (const auto &[network, length] : v6_text)
+        hits += check_ipv6_network(target.c_str(), network.c_str(), length);
+    double strings = seconds(start);
+
+    std::atomic<bool> stop{false};
+    std::atomic<size_t> reads{0};
+    std::thread reader([&] {
+        std::vector<uint32_t> batch(1024);
+        while (!stop) {
+            shared.read()->lookup(std::span(addrs).first(1024), batch.data());
+            ++reads;
+        }
+    });
+    start = Clock::now();
+    for (int i = 0; i < 3; ++i)
+        shared.publish(std::make_unique<LpmTable>(routes));
+    double reload = seconds(start) / 3;
+    stop = true;
+    reader.join();
+
+    std::cout << "LpmTable: " << routes.size() << " routes, " << (memory >> 20)
+              << " MiB, built in " << build << " s, rebuilt and swapped in "
+              << reload << " s (" << reads << " reader batches meanwhile)"
+              << std::endl;
+    std::cout << "  lookup " << hot * 1e9 << " ns (4096 addresses), "
+              << cold * 1e9 << " ns (1M addresses), linear scan "
+              << linear * 1e6 << " us, check_ipv6_network over "
+              << v6_text.size() << " IPv6 routes " << strings * 1e3
+              << " ms (hits " << hits << ")" << std::endl;
+}
+
+// Lines for the IPv4 text checks: addresses, addresses with one character
+// changed, dropped or added, and short random strings over digits and dots.
+static std::string fuzzLines(size_t count, std::mt19937_64 &rng) {
+    static const char alphabet[] = "0123456789.....x 0";
+    std::string text;
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t r = rng();
+        std::string line;
+        if (r % 8 < 5) {
+            // Octets biased to the interesting lengths and to 255/256.
+            for (int k = 0; k < 4; ++k) {
+                uint64_t o = rng();
+                unsigned v = o % 4 == 0   ? static_cast<unsigned>(o >> 8) % 10
+                             : o % 4 == 1 ? static_cast<unsigned>(o >> 8) % 100
+                             : o % 4 == 2 ? 250 + static_cast<unsigned>(o >> 8) % 10
+                                          : static_cast<unsigned>(o >> 8) % 256;
+                if (k > 0)
+                    line += '.';
+                line += std::to_string(v);
+            }
+            size_t at = (r >> 8) % (line.size() + 1);
+            char c = alphabet[(r >> 16) % (sizeof(alphabet) - 1)];
+            switch (r >> 24 & 7) {
+            case 0: line.insert(at, 1, c); break;
+            case 1: if (at < line.size()) line.erase(at, 1); break;
+            case 2: if (at < line.size()) line[at] = c; break;
+            default: break;
+            }
+        } else {
+            size_t length = (r >> 8) % 20;
+            for (size_t j = 0; j < length; ++j)
+                line += alphabet[rng() % (sizeof(alphabet) - 1)];
+        }
+        text += line;
+        text += '\n';
+    }
+    return text;
+}
+
+// Every IPv4Text kernel against inet_pton/inet_ntop on `count` fuzz lines,
+// parsed whole and in random chunks, and on as many random addresses.
+static bool checkIPv4Text(size_t count) {
+    std::mt19937_64 rng(5);
+    std::string text = fuzzLines(count, rng);
+
+    std::vector<uint32_t> want;
+    std::vector<uint8_t> want_valid;
+    for (size_t p = 0; p < text.size();) {
+        size_t nl = text.find('\n', p);
+        std::string line = text.substr(p, nl - p);
+        in_addr a;
+        bool ok = inet_pton(AF_INET, line.c_str(), &a) == 1;
+        want.push_back(ok ? ntohl(a.s_addr) : 0);
+        want_valid.push_back(ok);
+        p = nl + 1;
+    }
+
+    std::vector<uint32_t> addrs(count);
+    for (uint32_t &a : addrs) {
+        a = static_cast<uint32_t>(rng());
+    }
+    addrs[0] = 0;
+    addrs[1] = 0xffffffff;
+    std::string formatted;
+    for (uint32_t a : addrs) {
+        in_addr n{htonl(a)};
+        char buf[INET_ADDRSTRLEN];
+        formatted += inet_ntop(AF_INET, &n, buf, sizeof(buf));
+        formatted += '\n';
+    }
+
+    for (const IPv4Text::Kernels &k : IPv4Text::available()) {
+        std::vector<uint32_t> out(want.size() + 1);
+        std::vector<uint8_t> valid(want.size() + 1);
+        size_t consumed = 0;
+        size_t n = k.parse(text.data(), text.size(), out.data(), valid.data(),
+                           out.size(), true, &consumed);
+        bool same = n == want.size() && consumed == text.size();
+        for (size_t i = 0; same && i < n; ++i)
+            same = out[i] == want[i] && valid[i] == want_valid[i];
+
+        // Chunks of up to 64 bytes, carrying the unfinished line over.
+        size_t lines = 0;
+        std::string carry;
+        for (size_t p = 0; same && p < text.size();) {
+            size_t take = std::min<size_t>(1 + rng() % 64, text.size() - p);
+            carry.append(text, p, take);
+            p += take;
+            size_t used = 0;
+            size_t got = k.parse(carry.data(), carry.size(), out.data() + lines,
+                                 valid.data() + lines, out.size() - lines,
+                                 p == text.size(), &used);
+            for (size_t i = lines; same && i < lines + got; ++i)
+                same = out[i] == want[i] && valid[i] == want_valid[i];
+            lines += got;
+            carry.erase(0, used);
+        }
+        same = same && lines == want.size();
+
+        std::string lines_out(addrs.size() * IPv4Text::kMaxLine, '\0');
+        lines_out.resize(k.format(addrs.data(), addrs.size(), lines_out.data()));
+        if (!same || lines_out != formatted) {
+            std::cerr << "IPv4Text " << k.name << " disagrees with "
+                      << (same ? "inet_ntop" : "inet_pton") << std::endl;
+            return false;
+        }
+    }
+    std::cout << "IPv4Text agrees with inet_pton/inet_ntop on " << count
+              << " lines (selected: " << IPv4Text::implementation() << ")"
+              << std::endl;
+    return true;
+}
+
+// Addresses per second for each kernel, against inet_pton and inet_ntop a
+// line at a time.
+static void benchIPv4Text() {
+    using Clock = std::chrono::steady_clock;
+    std::mt19937_64 rng(6);
+    std::vector<uint32_t> addrs(1 << 20);
+    for (uint32_t &a : addrs) {
+        a = static_cast<uint32_t>(rng());
+    }
+    std::string text(addrs.size() * IPv4Text::kMaxLine, '\0');
+    text.resize(IPv4Text::formatLines(addrs, text.data()));
+    std::vector<uint32_t> out(addrs.size());
+    std::vector<uint8_t> valid(addrs.size());
+    auto rate = [&](Clock::time_point start) {
+        return static_cast<double>(addrs.size()) / 1e6 /
+               std::chrono::duration<double>(Clock::now() - start).count();
+    };
+
+    size_t sink = 0;
+    auto start = Clock::now();
+    for (size_t p = 0, i = 0; p < text.size(); ++i) {
+        size_t nl = text.find('\n', p);
+        text[nl] = '\0';
+        in_addr a;
+        sink += inet_pton(AF_INET, text.data() + p, &a) == 1 ? a.s_addr : 0;
+        text[nl] = '\n';
+        p = nl + 1;
+    }
+    double pton = rate(start);
+    start = Clock::now();
+    char buf[INET_ADDRSTRLEN];
+    for (uint32_t a : addrs) {
+        in_addr n{htonl(a)};
+        sink += strlen(inet_ntop(AF_INET, &n, buf, sizeof(buf)));
+    }
+    double ntop = rate(start);
+    printf("%-8s  parse %6.1f M/s  format %6.1f M/s\n", "libc", pton, ntop);
+
+    std::string formatted(text.size() + IPv4Text::kMaxLine, '\0');
+    for (const IPv4Text::Kernels &k : IPv4Text::available()) {
+        size_t consumed;
+        start = Clock::now();
+        sink += k.parse(text.data(), text.size(), out.data(), valid.data(),
+                        out.size(), true, &consumed);
+        double parse = rate(start);
+        start = Clock::now();
+        sink += k.format(addrs.data(), addrs.size(), formatted.data());
+        double format = rate(start);
+        printf("%-8s  parse %6.1f M/s  format %6.1f M/s\n", k.name, parse,
+               format);
+    }
+    if (sink == 0)
+        std::cout << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    // ./ip_netmask --ipv4-text [lines]: IPv4Text checks and benchmark only.
+    if (argc > 1 && strcmp(argv[1], "--ipv4-text") == 0) {
+        size_t lines = argc > 2 ? std::stoul(argv[2]) : 1000000;
+        if (!checkIPv4Text(lines))
+            return 1;
+        benchIPv4Text();
+        return 0;
+    }
+
+    // ./ip_netmask --lpm: LpmTable checks on a full-size table and benchmark.
+    if (argc > 1 && strcmp(argv[1], "--lpm") == 0) {
+        if (!checkLpm(true))
+            return 1;
+        benchLpm();
+        return 0;
+    }
+
     const std::string ip_addr_str = "192.168.1.100";
     const std::string netmask_str = "255.255.255.0";
     const std::string network_str = "192.168.1.0";
@@ -87,5 +586,10 @@ int main() {
         std::cout << "IPv6 address is not in network range" << std::endl;
     }
 
+    if (!checkPrefixes())
+        return 1;
+    benchPrefix();
+    if (!checkLpm(false))
+        return 1;
     return 0;
 }
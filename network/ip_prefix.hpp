@@ -0,0 +1,211 @@
+#pragma once
+
+#include <arpa/inet.h>
+#include <cstdint>
+#include <cstring>
+#include <netinet/in.h>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// An IPv4 or IPv6 address as two 64-bit words in host order, most
+// significant first. IPv4 addresses are stored IPv4-mapped (::ffff:a.b.c.d),
+// so one comparison path serves both families.
+struct Address {
+    uint64_t hi = 0;
+    uint64_t lo = 0;
+
+    static constexpr uint64_t kV4Mapped = 0xffffULL << 32;
+
+    static Address fromV4(uint32_t host_order) {
+        return Address{0, kV4Mapped | host_order};
+    }
+
+    static Address fromV6(const in6_addr &addr) {
+        Address a;
+        for (int i = 0; i < 8; ++i) {
+            a.hi = a.hi << 8 | addr.s6_addr[i];
+            a.lo = a.lo << 8 | addr.s6_addr[i + 8];
+        }
+        return a;
+    }
+
+    // Accepts dotted-quad IPv4 or any IPv6 text form inet_pton() takes.
+    // `family` gets AF_INET or AF_INET6 by the text's form, so that
+    // "::ffff:10.0.0.1" is IPv6 even though it is stored like 10.0.0.1.
+    static bool parse(const char *text, Address &out, int *family = nullptr) {
+        in_addr v4;
+        if (inet_pton(AF_INET, text, &v4) == 1) {
+            out = fromV4(ntohl(v4.s_addr));
+            if (family != nullptr)
+                *family = AF_INET;
+            return true;
+        }
+        in6_addr v6;
+        if (inet_pton(AF_INET6, text, &v6) == 1) {
+            out = fromV6(v6);
+            if (family != nullptr)
+                *family = AF_INET6;
+            return true;
+        }
+        return false;
+    }
+
+    bool isV4() const { return hi == 0 && (lo >> 32) == (kV4Mapped >> 32); }
+    uint32_t v4() const { return static_cast<uint32_t>(lo); }
+
+    std::string toString() const {
+        return toString(isV4() ? AF_INET : AF_INET6);
+    }
+
+    // AF_INET6 writes IPv4-mapped addresses as "::ffff:a.b.c.d".
+    std::string toString(int family) const {
+        char buf[INET6_ADDRSTRLEN];
+        if (family == AF_INET && isV4()) {
+            in_addr v4{htonl(this->v4())};
+            inet_ntop(AF_INET, &v4, buf, sizeof(buf));
+        } else {
+            in6_addr v6;
+            for (int i = 0; i < 8; ++i) {
+                v6.s6_addr[i] = static_cast<uint8_t>(hi >> (56 - 8 * i));
+                v6.s6_addr[i + 8] = static_cast<uint8_t>(lo >> (56 - 8 * i));
+            }
+            inet_ntop(AF_INET6, &v6, buf, sizeof(buf));
+        }
+        return buf;
+    }
+
+    bool operator==(const Address &) const = default;
+};
+
+// Fixed-size result of a batch membership test: bit i is address i.
+class AddressBits {
+  public:
+    explicit AddressBits(size_t size) : size_(size), words_((size + 63) / 64) {}
+
+    size_t size() const { return size_; }
+    bool test(size_t i) const { return (words_[i / 64] >> (i % 64)) & 1; }
+
+    size_t count() const {
+        size_t n = 0;
+        for (uint64_t w : words_) {
+            n += static_cast<size_t>(__builtin_popcountll(w));
+        }
+        return n;
+    }
+
+    uint64_t *words() { return words_.data(); }
+    const uint64_t *words() const { return words_.data(); }
+
+  private:
+    size_t size_;
+    std::vector<uint64_t> words_;
+};
+
+// A network parsed once: the masked network address and its mask as two
+// 64-bit words each, so membership is two AND-compares with no branches.
+// IPv4 prefixes live in the mapped range, with 96 added to their length.
+// The family comes from the caller, not from the address: ::ffff:0:0/96 is
+// an IPv6 prefix over the same addresses as the IPv4 0.0.0.0/0.
+class Prefix {
+  public:
+    Prefix() = default;
+
+    // `length` counts bits in `family` terms: up to 32 for AF_INET, up to
+    // 128 for AF_INET6. Host bits of `network` are cleared.
+    Prefix(const Address &network, int length, int family)
+        : v4_(family == AF_INET) {
+        length_ = v4_ ? length + 96 : length;
+        if (length_ < 0)
+            length_ = 0;
+        if (length_ > 128)
+            length_ = 128;
+        mask_.hi = maskWord(length_);
+        mask_.lo = maskWord(length_ - 64);
+        network_.hi = network.hi & mask_.hi;
+        network_.lo = network.lo & mask_.lo;
+    }
+
+    // "10.0.0.0/8", "2001:db8::/32"; a bare address is a host prefix.
+    static bool parse(std::string_view text, Prefix &out) {
+        size_t slash = text.find('/');
+        std::string addr(text.substr(0, slash));
+        Address network;
+        int family;
+        if (!Address::parse(addr.c_str(), network, &family))
+            return false;
+        int max = family == AF_INET ? 32 : 128;
+        int length = max;
+        if (slash != std::string_view::npos) {
+            std::string_view bits = text.substr(slash + 1);
+            if (bits.empty() || bits.size() > 3)
+                return false;
+            length = 0;
+            for (char c : bits) {
+                if (c < '0' || c > '9')
+                    return false;
+                length = length * 10 + (c - '0');
+            }
+            if (length > max)
+                return false;
+        }
+        out = Prefix(network, length, family);
+        return true;
+    }
+
+    const Address &network() const { return network_; }
+    const Address &mask() const { return mask_; }
+    bool isV4() const { return v4_; }
+    // Length in the family's own terms (0-32 for IPv4).
+    int length() const { return v4_ ? length_ - 96 : length_; }
+    // Length over the 128-bit mapped form, whatever the family.
+    int bits() const { return length_; }
+
+    bool contains(const Address &a) const {
+        return ((a.hi & mask_.hi) == network_.hi) &
+               ((a.lo & mask_.lo) == network_.lo);
+    }
+
+    // One bit per address, built 64 at a time without branches.
+    AddressBits contains(std::span<const Address> addrs) const {
+        AddressBits bits(addrs.size());
+        uint64_t *words = bits.words();
+        size_t i = 0;
+        for (; i + 64 <= addrs.size(); i += 64) {
+            uint64_t w = 0;
+            for (size_t j = 0; j < 64; ++j) {
+                w |= static_cast<uint64_t>(contains(addrs[i + j])) << j;
+            }
+            words[i / 64] = w;
+        }
+        if (i < addrs.size()) {
+            uint64_t w = 0;
+            for (size_t j = 0; i + j < addrs.size(); ++j) {
+                w |= static_cast<uint64_t>(contains(addrs[i + j])) << j;
+            }
+            words[i / 64] = w;
+        }
+        return bits;
+    }
+
+    std::string toString() const {
+        return network_.toString(v4_ ? AF_INET : AF_INET6) + "/" +
+               std::to_string(length());
+    }
+
+  private:
+    // The top `bits` bits of a word set; bits may be out of [0, 64].
+    static uint64_t maskWord(int bits) {
+        if (bits <= 0)
+            return 0;
+        if (bits >= 64)
+            return ~0ULL;
+        return ~0ULL << (64 - bits);
+    }
+
+    Address network_;
+    Address mask_;
+    int length_ = 0;
+    bool v4_ = false;
+};
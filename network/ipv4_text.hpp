@@ -0,0 +1,489 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string_view>
+#include <type_traits>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+// Dotted-quad IPv4 text to host-order uint32_t and back, a batch at a time.
+// Parsing accepts exactly what inet_pton(AF_INET) accepts: four decimal
+// fields of 0-255 without leading zeros. Formatting matches inet_ntop().
+//
+// Three kernels, picked once by CPUID:
+//  - avx2: two addresses per 256-bit register.
+//  - sse41: one address per register. The dots give each field's length;
+//    the four lengths select one of 81 shuffles that right-align every
+//    field's digits in its own 32-bit lane, and one multiply-add turns the
+//    lanes into numbers. Formatting runs the other way: the digits of all
+//    four octets are computed side by side, and a shuffle chosen by their
+//    lengths packs them with the dots.
+//  - scalar: a byte at a time, and the reference for the others.
+class IPv4Text {
+  public:
+    // Longest address plus its newline.
+    static constexpr size_t kMaxLine = 16;
+
+    // Parses newline-separated addresses from `text` until it or `out` runs
+    // out. out[i] gets the address, valid[i] whether line i was one (out[i]
+    // is 0 if not). Returns the number of lines; *consumed is how much of
+    // `text` they took, so a caller can carry an unfinished last line over.
+    // A last line without a newline counts only if `text` is final.
+    static size_t parseLines(std::string_view text, std::span<uint32_t> out,
+                             std::span<uint8_t> valid, bool final,
+                             size_t *consumed) {
+        return kernels().parse(text.data(), text.size(), out.data(),
+                               valid.data(), std::min(out.size(), valid.size()),
+                               final, consumed);
+    }
+
+    // Writes one address per line. `out` needs kMaxLine * in.size() bytes;
+    // returns how many were written.
+    static size_t formatLines(std::span<const uint32_t> in, char *out) {
+        return kernels().format(in.data(), in.size(), out);
+    }
+
+    static bool parse(const char *text, size_t size, uint32_t &out) {
+        return parseScalar(text, size, out);
+    }
+
+    // Writes up to 15 characters, no terminator; returns the length.
+    static size_t format(uint32_t address, char *out) {
+        return formatScalar(address, out);
+    }
+
+    static const char *implementation() { return kernels().name; }
+
+    using ParseFn = size_t (*)(const char *, size_t, uint32_t *, uint8_t *,
+                               size_t, bool, size_t *);
+    using FormatFn = size_t (*)(const uint32_t *, size_t, char *);
+
+    struct Kernels {
+        const char *name;
+        ParseFn parse;
+        FormatFn format;
+    };
+
+    // Every kernel this CPU can run, scalar first; for tests and benchmarks.
+    static std::span<const Kernels> available() {
+        static const Kernels all[] = {
+            {"scalar", parseLinesWith<Scalar>, formatLinesWith<Scalar>},
+#if defined(__x86_64__)
+            {"sse4.1", parseLinesWith<Sse41>, formatLinesWith<Sse41>},
+            {"avx2", parseLinesAvx2, formatLinesAvx2},
+#endif
+        };
+#if defined(__x86_64__)
+        static const size_t count = __builtin_cpu_supports("avx2")     ? 3
+                                    : __builtin_cpu_supports("sse4.1") ? 2
+                                                                       : 1;
+#else
+        static const size_t count = 1;
+#endif
+        return std::span<const Kernels>(all, count);
+    }
+
+  private:
+    static const Kernels &kernels() {
+        static const Kernels &best = available().back();
+        return best;
+    }
+
+    // inet_pton(AF_INET) rules.
+    static bool parseScalar(const char *p, size_t size, uint32_t &out) {
+        uint32_t address = 0;
+        size_t i = 0;
+        for (int field = 0; field < 4; ++field) {
+            if (field > 0) {
+                if (i == size || p[i] != '.')
+                    return false;
+                ++i;
+            }
+            size_t start = i;
+            uint32_t value = 0;
+            while (i < size && p[i] >= '0' && p[i] <= '9' && i - start < 3) {
+                value = value * 10 + static_cast<uint32_t>(p[i] - '0');
+                ++i;
+            }
+            size_t digits = i - start;
+            if (digits == 0 || value > 255 || (digits > 1 && p[start] == '0'))
+                return false;
+            address = address << 8 | value;
+        }
+        if (i != size)
+            return false;
+        out = address;
+        return true;
+    }
+
+    static size_t formatScalar(uint32_t address, char *out) {
+        char *p = out;
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            uint32_t v = (address >> shift) & 0xff;
+            if (v >= 100)
+                *p++ = static_cast<char>('0' + v / 100);
+            if (v >= 10)
+                *p++ = static_cast<char>('0' + v / 10 % 10);
+            *p++ = static_cast<char>('0' + v % 10);
+            if (shift != 0)
+                *p++ = '.';
+        }
+        return static_cast<size_t>(p - out);
+    }
+
+    // Where the line starting at `p` ends: the newline, or `end` when there
+    // is none (nullptr-safe memchr).
+    static const char *lineEnd(const char *p, const char *end) {
+        const void *nl = p == end ? nullptr : memchr(p, '\n', end - p);
+        return nl != nullptr ? static_cast<const char *>(nl) : end;
+    }
+
+    struct Scalar {
+        static size_t format(uint32_t address, char *out) {
+            size_t n = formatScalar(address, out);
+            out[n] = '\n';
+            return n + 1;
+        }
+    };
+
+    // The batch loop shared by the one-address kernels. K::parseLine returns
+    // false when it cannot decide from its 16-byte view, and the scalar
+    // parser takes the line instead.
+    template <typename K>
+    static size_t parseLinesWith(const char *text, size_t size, uint32_t *out,
+                                 uint8_t *valid, size_t max, bool final,
+                                 size_t *consumed) {
+        const char *p = text, *end = text + size;
+        size_t n = 0;
+        while (n < max && p < end) {
+            const char *next = nullptr;
+            bool ok = false, done = false;
+            uint32_t address = 0;
+            if constexpr (!std::is_same_v<K, Scalar>)
+                done = end - p >= 16 && K::parseLine(p, address, ok, next);
+            if (!done) {
+                next = lineEnd(p, end);
+                if (next == end && !final)
+                    break;
+                ok = parseScalar(p, static_cast<size_t>(next - p), address);
+            }
+            out[n] = ok ? address : 0;
+            valid[n] = ok;
+            ++n;
+            p = next == end ? end : next + 1;
+        }
+        *consumed = static_cast<size_t>(p - text);
+        return n;
+    }
+
+    template <typename K>
+    static size_t formatLinesWith(const uint32_t *in, size_t count, char *out) {
+        char *p = out;
+        for (size_t i = 0; i < count; ++i) {
+            p += K::format(in[i], p);
+        }
+        return static_cast<size_t>(p - out);
+    }
+
+#if defined(__x86_64__)
+    using Pattern = std::array<uint8_t, 16>;
+
+    // Field lengths (1-3 each) numbered base 3, first field most
+    // significant.
+    static unsigned patternIndex(unsigned l0, unsigned l1, unsigned l2,
+                                 unsigned l3) {
+        return (l0 - 1) * 27 + (l1 - 1) * 9 + (l2 - 1) * 3 + (l3 - 1);
+    }
+
+    // For parsing: field k's digits right-aligned in bytes 4k+1..4k+3.
+    static constexpr std::array<Pattern, 81> makeParsePatterns() {
+        std::array<Pattern, 81> patterns{};
+        for (unsigned i = 0; i < 81; ++i) {
+            unsigned lens[4] = {i / 27 + 1, i / 9 % 3 + 1, i / 3 % 3 + 1,
+                                i % 3 + 1};
+            Pattern &p = patterns[i];
+            p.fill(0x80);
+            unsigned start = 0;
+            for (unsigned k = 0; k < 4; ++k) {
+                for (unsigned j = 0; j < lens[k]; ++j)
+                    p[4 * k + 4 - lens[k] + j] = static_cast<uint8_t>(start + j);
+                start += lens[k] + 1;
+            }
+        }
+        return patterns;
+    }
+
+    // For formatting from [h0-h3, t0-t3, u0-u3, '.', '\n']: the digits each
+    // octet needs, dots between, a newline last.
+    static constexpr std::array<Pattern, 81> makeFormatPatterns() {
+        std::array<Pattern, 81> patterns{};
+        for (unsigned i = 0; i < 81; ++i) {
+            unsigned lens[4] = {i / 27 + 1, i / 9 % 3 + 1, i / 3 % 3 + 1,
+                                i % 3 + 1};
+            Pattern &p = patterns[i];
+            p.fill(0x80);
+            unsigned at = 0;
+            for (unsigned k = 0; k < 4; ++k) {
+                if (lens[k] == 3)
+                    p[at++] = static_cast<uint8_t>(k);
+                if (lens[k] >= 2)
+                    p[at++] = static_cast<uint8_t>(4 + k);
+                p[at++] = static_cast<uint8_t>(8 + k);
+                p[at++] = k < 3 ? 12 : 13;
+            }
+        }
+        return patterns;
+    }
+
+    alignas(16) static const std::array<Pattern, 81> kParsePatterns;
+    alignas(16) static const std::array<Pattern, 81> kFormatPatterns;
+
+    static __m128i pattern(const std::array<Pattern, 81> &table, unsigned i) {
+        return _mm_load_si128(reinterpret_cast<const __m128i *>(table[i].data()));
+    }
+
+    // What the scalar side of parsing works out from one 16-byte view.
+    struct Fields {
+        unsigned length;     // characters before the first non [0-9.]
+        unsigned index;      // shuffle for the field lengths
+        bool well_formed;    // 3 dots, fields of 1-3 digits, no leading 0
+    };
+
+    __attribute__((target("sse4.1"))) static Fields scan(__m128i v,
+                                                         const char *p) {
+        __m128i d = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+        __m128i digit = _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d);
+        __m128i dot = _mm_cmpeq_epi8(v, _mm_set1_epi8('.'));
+        unsigned ok = static_cast<unsigned>(
+            _mm_movemask_epi8(_mm_or_si128(digit, dot)));
+        unsigned length = static_cast<unsigned>(__builtin_ctz(~ok | 0x10000));
+        return fields(static_cast<unsigned>(_mm_movemask_epi8(dot)), length, p);
+    }
+
+    // The fields of the `length` characters at p, from the mask of its dots
+    // (bit i for p[i], bits past `length` ignored).
+    static Fields fields(unsigned dots, unsigned length, const char *p) {
+        dots &= (1u << length) - 1;
+        Fields f{length, 0, false};
+        if (__builtin_popcount(dots) != 3)
+            return f;
+        unsigned d1 = static_cast<unsigned>(__builtin_ctz(dots));
+        dots &= dots - 1;
+        unsigned d2 = static_cast<unsigned>(__builtin_ctz(dots));
+        dots &= dots - 1;
+        unsigned d3 = static_cast<unsigned>(__builtin_ctz(dots));
+        unsigned l0 = d1, l1 = d2 - d1 - 1, l2 = d3 - d2 - 1,
+                 l3 = length - d3 - 1;
+        if (l0 - 1 > 2 || l1 - 1 > 2 || l2 - 1 > 2 || l3 - 1 > 2)
+            return f;
+        if ((l0 > 1 && p[0] == '0') || (l1 > 1 && p[d1 + 1] == '0') ||
+            (l2 > 1 && p[d2 + 1] == '0') || (l3 > 1 && p[d3 + 1] == '0'))
+            return f;
+        f.index = patternIndex(l0, l1, l2, l3);
+        f.well_formed = true;
+        return f;
+    }
+
+    // Lane k of `digits` holds field k as 0, hundreds, tens, ones.
+    __attribute__((target("sse4.1"))) static __m128i fieldValues(
+        __m128i digits) {
+        const __m128i weights = _mm_set1_epi32(0x010a6400);  // 0, 100, 10, 1
+        __m128i pairs = _mm_maddubs_epi16(digits, weights);
+        return _mm_madd_epi16(pairs, _mm_set1_epi16(1));
+    }
+
+    struct Sse41 {
+        // Parses the line at p (16 bytes readable) if the view covers it.
+        __attribute__((target("sse4.1"))) static bool parseLine(
+            const char *p, uint32_t &address, bool &ok, const char *&next) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            Fields f = scan(v, p);
+            if (f.length == 16 || p[f.length] != '\n')
+                return false;  // long line, or junk: let the scalar path say
+            next = p + f.length;
+            ok = f.well_formed;
+            if (!ok)
+                return true;
+            __m128i d = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+            __m128i values = fieldValues(
+                _mm_shuffle_epi8(d, pattern(kParsePatterns, f.index)));
+            if (_mm_movemask_epi8(
+                    _mm_cmpgt_epi32(values, _mm_set1_epi32(255))) != 0) {
+                ok = false;
+                return true;
+            }
+            __m128i bytes = _mm_packus_epi16(_mm_packus_epi32(values, values),
+                                             values);
+            address = __builtin_bswap32(
+                static_cast<uint32_t>(_mm_cvtsi128_si32(bytes)));
+            return true;
+        }
+
+        // Writes 16 bytes at out; returns the line length.
+        __attribute__((target("sse4.1"))) static size_t format(uint32_t address,
+                                                               char *out) {
+            __m128i ascii = digits(_mm_cvtepu8_epi16(
+                _mm_cvtsi32_si128(static_cast<int>(__builtin_bswap32(address)))));
+            unsigned index = formatIndex(address);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out),
+                             _mm_shuffle_epi8(ascii, pattern(kFormatPatterns, index)));
+            return formatLength(index);
+        }
+
+        // Octets in 16-bit lanes 0-3 to [h0-h3, t0-t3, u0-u3, '.', '\n'] as
+        // ASCII. x/100 is (x * 656) >> 16 and x/10 is (x * 6554) >> 16 for
+        // the ranges involved.
+        __attribute__((target("sse4.1"))) static __m128i digits(__m128i o) {
+            __m128i h = _mm_mulhi_epu16(o, _mm_set1_epi16(656));
+            __m128i r = _mm_sub_epi16(o, _mm_mullo_epi16(h, _mm_set1_epi16(100)));
+            __m128i t = _mm_mulhi_epu16(r, _mm_set1_epi16(6554));
+            __m128i u = _mm_sub_epi16(r, _mm_mullo_epi16(t, _mm_set1_epi16(10)));
+            __m128i bytes = _mm_packus_epi16(_mm_unpacklo_epi64(h, t), u);
+            return _mm_add_epi8(bytes, _mm_setr_epi8('0', '0', '0', '0', '0', '0',
+                                                     '0', '0', '0', '0', '0', '0',
+                                                     '.', '\n', 0, 0));
+        }
+    };
+
+    static unsigned octetLength(uint32_t v) { return 1 + (v >= 10) + (v >= 100); }
+
+    static unsigned formatIndex(uint32_t a) {
+        return patternIndex(octetLength(a >> 24), octetLength((a >> 16) & 0xff),
+                            octetLength((a >> 8) & 0xff), octetLength(a & 0xff));
+    }
+
+    // Digits, three dots and the newline.
+    static size_t formatLength(unsigned index) {
+        return index / 27 + index / 9 % 3 + index / 3 % 3 + index % 3 + 8;
+    }
+
+    // Two lines per step: one 32-byte compare finds both lines' dots and
+    // ends, then both go through the arithmetic in one register. Lines
+    // that do not fit a view go one at a time through the sse4.1 kernel.
+    __attribute__((target("avx2"))) static size_t parseLinesAvx2(
+        const char *text, size_t size, uint32_t *out, uint8_t *valid,
+        size_t max, bool final, size_t *consumed) {
+        const char *p = text, *end = text + size;
+        size_t n = 0;
+        while (n < max && p < end) {
+            // One 32-byte view finds both lines; each must end inside its
+            // own 16 bytes.
+            const char *q = nullptr;
+            Fields f0{16, 0, false}, f1{16, 0, false};
+            if (n + 2 <= max && end - p >= 48) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+                __m256i d = _mm256_sub_epi8(v, _mm256_set1_epi8('0'));
+                __m256i digit = _mm256_cmpeq_epi8(
+                    _mm256_min_epu8(d, _mm256_set1_epi8(9)), d);
+                __m256i dot = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('.'));
+                uint32_t ok = static_cast<uint32_t>(
+                    _mm256_movemask_epi8(_mm256_or_si256(digit, dot)));
+                uint32_t dots = static_cast<uint32_t>(_mm256_movemask_epi8(dot));
+                unsigned l0 = static_cast<unsigned>(__builtin_ctz(~ok | 0x10000));
+                if (l0 < 16 && p[l0] == '\n') {
+                    f0 = fields(dots, l0, p);
+                    unsigned off = l0 + 1;
+                    q = p + off;
+                    unsigned l1 = static_cast<unsigned>(
+                        __builtin_ctz(~(ok >> off) | (1u << (32 - off))));
+                    if (l1 < 16 && off + l1 < 32 && q[l1] == '\n')
+                        f1 = fields(dots >> off, l1, q);
+                }
+            }
+            if (f1.length == 16) {
+                size_t used = 0;
+                if (parseLinesWith<Sse41>(p, static_cast<size_t>(end - p), out + n,
+                                          valid + n, 1, final, &used) == 0)
+                    break;
+                ++n;
+                p += used;
+                continue;
+            }
+
+            __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(q));
+            __m256i d = _mm256_sub_epi8(_mm256_set_m128i(v1, v0),
+                                        _mm256_set1_epi8('0'));
+            __m256i shuffle = _mm256_set_m128i(pattern(kParsePatterns, f1.index),
+                                               pattern(kParsePatterns, f0.index));
+            __m256i digits = _mm256_shuffle_epi8(d, shuffle);
+            __m256i values = _mm256_madd_epi16(
+                _mm256_maddubs_epi16(digits, _mm256_set1_epi32(0x010a6400)),
+                _mm256_set1_epi16(1));
+            __m256i over = _mm256_cmpgt_epi32(values, _mm256_set1_epi32(255));
+            __m256i bytes = _mm256_packus_epi16(
+                _mm256_packus_epi32(values, values), values);
+            unsigned over_mask = static_cast<unsigned>(_mm256_movemask_epi8(over));
+
+            bool ok0 = f0.well_formed && (over_mask & 0xffff) == 0;
+            bool ok1 = f1.well_formed && (over_mask >> 16) == 0;
+            out[n] = ok0 ? __builtin_bswap32(static_cast<uint32_t>(
+                               _mm256_extract_epi32(bytes, 0)))
+                         : 0;
+            out[n + 1] = ok1 ? __builtin_bswap32(static_cast<uint32_t>(
+                                   _mm256_extract_epi32(bytes, 4)))
+                             : 0;
+            valid[n] = ok0;
+            valid[n + 1] = ok1;
+            n += 2;
+            p = q + f1.length + 1;
+        }
+        *consumed = static_cast<size_t>(p - text);
+        return n;
+    }
+
+    __attribute__((target("avx2"))) static size_t formatLinesAvx2(
+        const uint32_t *in, size_t count, char *out) {
+        char *p = out;
+        size_t i = 0;
+        for (; i + 2 <= count; i += 2) {
+            // Octets of the two addresses in 16-bit lanes 0-3 of each half.
+            __m256i o = _mm256_cvtepu8_epi16(_mm_set_epi32(
+                0, static_cast<int>(__builtin_bswap32(in[i + 1])), 0,
+                static_cast<int>(__builtin_bswap32(in[i]))));
+
+            __m256i h = _mm256_mulhi_epu16(o, _mm256_set1_epi16(656));
+            __m256i r = _mm256_sub_epi16(
+                o, _mm256_mullo_epi16(h, _mm256_set1_epi16(100)));
+            __m256i t = _mm256_mulhi_epu16(r, _mm256_set1_epi16(6554));
+            __m256i u = _mm256_sub_epi16(
+                r, _mm256_mullo_epi16(t, _mm256_set1_epi16(10)));
+            __m256i bytes = _mm256_packus_epi16(_mm256_unpacklo_epi64(h, t), u);
+            const __m128i tail = _mm_setr_epi8('0', '0', '0', '0', '0', '0', '0',
+                                               '0', '0', '0', '0', '0', '.',
+                                               '\n', 0, 0);
+            __m256i ascii = _mm256_add_epi8(bytes, _mm256_set_m128i(tail, tail));
+
+            unsigned i0 = formatIndex(in[i]), i1 = formatIndex(in[i + 1]);
+            __m256i lines = _mm256_shuffle_epi8(
+                ascii, _mm256_set_m128i(pattern(kFormatPatterns, i1),
+                                        pattern(kFormatPatterns, i0)));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(p),
+                             _mm256_castsi256_si128(lines));
+            p += formatLength(i0);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(p),
+                             _mm256_extracti128_si256(lines, 1));
+            p += formatLength(i1);
+        }
+        if (i < count)
+            p += Sse41::format(in[i], p);
+        return static_cast<size_t>(p - out);
+    }
+#endif
+};
+
+#if defined(__x86_64__)
+// Out of the class, where the builders are complete; still built at compile
+// time.
+alignas(16) inline const std::array<IPv4Text::Pattern, 81>
+    IPv4Text::kParsePatterns = IPv4Text::makeParsePatterns();
+alignas(16) inline const std::array<IPv4Text::Pattern, 81>
+    IPv4Text::kFormatPatterns = IPv4Text::makeFormatPatterns();
+#endif
@@ -0,0 +1,360 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "ip_prefix.hpp"
+
+// Longest-prefix match over a fixed set of IPv4 and IPv6 prefixes, after
+// Poptrie (Asai & Ohara, SIGCOMM 2015). Build with -mpopcnt (or a -march
+// that has it): every step of a lookup is a popcount.
+//
+// The top 16 bits of the key index a direct table. Below that each node
+// covers 6 bits with two 64-bit maps: `vector` marks the slots that have a
+// child node, and `leafvec` marks where a run of equal leaf values starts.
+// A node's children, and its leaves, are stored contiguously, so the next
+// index is a base plus the popcount of the map below the slot. One node is
+// 24 bytes and a lookup touches one cache line per level.
+//
+// IPv4 and IPv6 have separate tries (32- and 128-bit keys). An IPv6 prefix
+// covering the whole IPv4-mapped range, such as ::/0, also serves IPv4
+// addresses as a default below any IPv4 prefix, as Prefix::contains says.
+class LpmTable {
+  public:
+    static constexpr uint32_t kNoMatch = UINT32_MAX;
+
+    struct Route {
+        Prefix prefix;
+        uint32_t value;  // anything but kNoMatch; the last duplicate wins
+    };
+
+    explicit LpmTable(std::span<const Route> routes) {
+        // Shorter prefixes go in first, so a longer one that lands on the
+        // same binary node (the mapped-range defaults below) wins.
+        std::vector<const Route *> order;
+        for (const Route &r : routes) {
+            order.push_back(&r);
+        }
+        std::stable_sort(order.begin(), order.end(), [](const Route *a, const Route *b) {
+            return fullLength(a->prefix) < fullLength(b->prefix);
+        });
+
+        Builder v4, v6;
+        const Address mapped = Address::fromV4(0);
+        for (const Route *r : order) {
+            const Prefix &p = r->prefix;
+            // Whatever the family, a prefix inside the mapped range only
+            // holds IPv4 addresses.
+            if (p.bits() >= 96 && p.network().isV4()) {
+                v4.insert(uint64_t{p.network().v4()} << 32, 0, p.bits() - 96, r->value);
+            } else {
+                v6.insert(p.network().hi, p.network().lo, p.length(), r->value);
+                if (p.bits() <= 96 && p.contains(mapped))
+                    v4.insert(0, 0, 0, r->value);
+            }
+        }
+        v4_ = v4.build();
+        v6_ = v6.build();
+    }
+
+    uint32_t lookup(const Address &a) const {
+        return a.isV4() ? v4_.lookup(uint64_t{a.v4()} << 32, 0) : v6_.lookup(a.hi, a.lo);
+    }
+
+    uint32_t lookupV4(uint32_t host_order) const {
+        return v4_.lookup(uint64_t{host_order} << 32, 0);
+    }
+
+    // Runs kLanes lookups side by side, a level at a time.
+    void lookup(std::span<const Address> addrs, uint32_t *out) const {
+        for (size_t base = 0; base < addrs.size(); base += kLanes) {
+            size_t lanes = std::min(kLanes, addrs.size() - base);
+            Trie::Cursor cursors[kLanes];
+            const Trie *tries[kLanes];
+            unsigned active = 0;
+            for (size_t l = 0; l < lanes; ++l) {
+                const Address &a = addrs[base + l];
+                bool v4 = a.isV4();
+                tries[l] = v4 ? &v4_ : &v6_;
+                bool done = v4 ? v4_.start(cursors[l], uint64_t{a.v4()} << 32, 0, out[base + l])
+                               : v6_.start(cursors[l], a.hi, a.lo, out[base + l]);
+                if (!done)
+                    active |= 1u << l;
+            }
+            while (active != 0) {
+                for (unsigned left = active; left != 0; left &= left - 1) {
+                    unsigned l = static_cast<unsigned>(std::countr_zero(left));
+                    if (tries[l]->step(cursors[l], out[base + l]))
+                        active &= ~(1u << l);
+                }
+            }
+        }
+    }
+
+    size_t memoryBytes() const { return v4_.memoryBytes() + v6_.memoryBytes(); }
+
+  private:
+    static constexpr int kDirectBits = 16;
+    static constexpr int kStride = 6;
+    static constexpr size_t kLanes = 8;
+
+    static int fullLength(const Prefix &p) { return p.bits(); }
+
+    // Six key bits starting at `pos`, past the end reading as zeros.
+    static unsigned chunk(uint64_t hi, uint64_t lo, int pos) {
+        uint64_t word = pos < 64 ? hi : lo;
+        int off = pos & 63;
+        if (off <= 64 - kStride)
+            return static_cast<unsigned>(word >> (64 - kStride - off)) & 63;
+        uint64_t next = pos < 64 ? lo : 0;
+        return static_cast<unsigned>((word << (off - (64 - kStride))) |
+                                     (next >> (128 - kStride - off))) & 63;
+    }
+
+    static bool bit(uint64_t hi, uint64_t lo, int pos) {
+        return pos < 64 ? (hi >> (63 - pos)) & 1 : (lo >> (127 - pos)) & 1;
+    }
+
+    struct Node {
+        uint64_t vector;
+        uint64_t leafvec;
+        uint32_t base0;  // first leaf
+        uint32_t base1;  // first child
+    };
+
+    class Trie {
+      public:
+        // A lookup in progress. Batches advance several of them in turn so
+        // that their cache misses overlap instead of queueing.
+        struct Cursor {
+            uint64_t hi;
+            uint64_t lo;
+            const Node *node;
+            int pos;
+        };
+
+        // Both return true once `value` holds the result.
+        bool start(Cursor &c, uint64_t hi, uint64_t lo, uint32_t &value) const {
+            uint64_t d = direct_[hi >> (64 - kDirectBits)];
+            if ((d >> 32) == 0) {
+                value = static_cast<uint32_t>(d);
+                return true;
+            }
+            c = Cursor{hi, lo, &nodes_[static_cast<uint32_t>(d)], kDirectBits};
+            __builtin_prefetch(c.node);
+            return false;
+        }
+
+        bool step(Cursor &c, uint32_t &value) const {
+            const Node *node = c.node;
+            uint64_t slot = uint64_t{1} << chunk(c.hi, c.lo, c.pos);
+            uint64_t upto = (slot << 1) - 1;  // all ones for slot 63
+            if ((node->vector & slot) == 0) {
+                value = leaves_[node->base0 + std::popcount(node->leafvec & upto) - 1];
+                return true;
+            }
+            c.node = &nodes_[node->base1 + std::popcount(node->vector & upto) - 1];
+            c.pos += kStride;
+            __builtin_prefetch(c.node);
+            return false;
+        }
+
+        uint32_t lookup(uint64_t hi, uint64_t lo) const {
+            Cursor c;
+            uint32_t value;
+            if (!start(c, hi, lo, value)) {
+                while (!step(c, value)) {
+                }
+            }
+            return value;
+        }
+
+        size_t memoryBytes() const {
+            return direct_.size() * sizeof(uint64_t) + nodes_.size() * sizeof(Node) +
+                   leaves_.size() * sizeof(uint32_t);
+        }
+
+      private:
+        friend class LpmTable;
+
+        // Leaf values, or 1 << 32 | node index.
+        std::vector<uint64_t> direct_;
+        std::vector<Node> nodes_;
+        std::vector<uint32_t> leaves_;
+    };
+
+    // A plain binary trie of the prefixes, turned into a Trie by build().
+    class Builder {
+      public:
+        Builder() : bin_(1) {}
+
+        void insert(uint64_t hi, uint64_t lo, int length, uint32_t value) {
+            uint32_t n = 0;
+            for (int i = 0; i < length; ++i) {
+                int b = bit(hi, lo, i);
+                if (bin_[n].child[b] == 0) {
+                    bin_[n].child[b] = static_cast<uint32_t>(bin_.size());
+                    bin_.push_back(BinNode{});
+                }
+                n = bin_[n].child[b];
+            }
+            bin_[n].value = value;
+        }
+
+        Trie build() {
+            Trie t;
+            t.direct_.resize(size_t{1} << kDirectBits);
+            for (uint64_t i = 0; i < t.direct_.size(); ++i) {
+                Slot s = descend(0, kDirectBits, i, bin_[0].value);
+                if (s.node == kNone) {
+                    t.direct_[i] = s.value;
+                } else {
+                    uint32_t at = static_cast<uint32_t>(t.nodes_.size());
+                    t.nodes_.push_back(Node{});
+                    buildNode(t, s.node, kDirectBits, s.value, at);
+                    t.direct_[i] = uint64_t{1} << 32 | at;
+                }
+            }
+            return t;
+        }
+
+      private:
+        static constexpr uint32_t kNone = 0;  // the root is never a child
+
+        struct BinNode {
+            uint32_t child[2] = {0, 0};
+            uint32_t value = kNoMatch;
+        };
+
+        struct Slot {
+            uint32_t node;   // binary node with descendants, or kNone
+            uint32_t value;  // longest match on the way there
+        };
+
+        // Follows `bits` bits of `path` down from binary node n.
+        Slot descend(uint32_t n, int bits, uint64_t path, uint32_t value) const {
+            for (int i = bits - 1; i >= 0; --i) {
+                n = bin_[n].child[(path >> i) & 1];
+                if (n == kNone)
+                    return Slot{kNone, value};
+                if (bin_[n].value != kNoMatch)
+                    value = bin_[n].value;
+            }
+            const BinNode &b = bin_[n];
+            bool inner = b.child[0] != kNone || b.child[1] != kNone;
+            return Slot{inner ? n : kNone, value};
+        }
+
+        // Fills t.nodes_[at] for binary node n at key depth `depth`.
+        void buildNode(Trie &t, uint32_t n, int depth, uint32_t value, uint32_t at) const {
+            Slot slots[64];
+            Node node{0, 0, 0, 0};
+            for (unsigned i = 0; i < 64; ++i) {
+                slots[i] = descend(n, kStride, i, value);
+                if (slots[i].node != kNone)
+                    node.vector |= uint64_t{1} << i;
+            }
+
+            node.base1 = static_cast<uint32_t>(t.nodes_.size());
+            t.nodes_.resize(t.nodes_.size() + std::popcount(node.vector));
+            node.base0 = static_cast<uint32_t>(t.leaves_.size());
+            bool first = true;
+            for (unsigned i = 0; i < 64; ++i) {
+                if (slots[i].node != kNone)
+                    continue;
+                if (first || slots[i].value != t.leaves_.back()) {
+                    node.leafvec |= uint64_t{1} << i;
+                    t.leaves_.push_back(slots[i].value);
+                    first = false;
+                }
+            }
+            t.nodes_[at] = node;
+
+            uint32_t child = node.base1;
+            for (unsigned i = 0; i < 64; ++i) {
+                if (slots[i].node != kNone)
+                    buildNode(t, slots[i].node, depth + kStride, slots[i].value, child++);
+            }
+        }
+
+        std::vector<BinNode> bin_;
+    };
+
+    Trie v4_;
+    Trie v6_;
+};
+
+// The table currently in use, replaceable while lookups run. Readers enter
+// a two-generation read section (no locks, no reference counting of the
+// table) and publish() swaps the pointer, waits until every reader that may
+// still see the old table has left, and frees it. Reloads never block
+// lookups; only concurrent publish() calls wait for each other.
+class SharedLpmTable {
+  public:
+    explicit SharedLpmTable(std::unique_ptr<const LpmTable> table) : table_(table.release()) {}
+
+    SharedLpmTable(const SharedLpmTable &) = delete;
+    SharedLpmTable &operator=(const SharedLpmTable &) = delete;
+
+    ~SharedLpmTable() { delete table_.load(); }
+
+    // Keeps the table it returns alive while it exists.
+    class ReadGuard {
+      public:
+        explicit ReadGuard(const SharedLpmTable &owner) : owner_(owner) {
+            for (;;) {
+                idx_ = owner_.epoch_.load() & 1;
+                owner_.readers_[idx_].count.fetch_add(1);
+                if ((owner_.epoch_.load() & 1) == idx_)
+                    break;
+                owner_.readers_[idx_].count.fetch_sub(1);
+            }
+            table_ = owner_.table_.load(std::memory_order_acquire);
+        }
+        ~ReadGuard() { owner_.readers_[idx_].count.fetch_sub(1, std::memory_order_release); }
+
+        ReadGuard(const ReadGuard &) = delete;
+        ReadGuard &operator=(const ReadGuard &) = delete;
+
+        const LpmTable *operator->() const { return table_; }
+        const LpmTable &operator*() const { return *table_; }
+
+      private:
+        const SharedLpmTable &owner_;
+        uint32_t idx_;
+        const LpmTable *table_;
+    };
+
+    // One guard per batch keeps the cost of the read section off each
+    // lookup.
+    ReadGuard read() const { return ReadGuard(*this); }
+
+    uint32_t lookup(const Address &a) const { return read()->lookup(a); }
+
+    void publish(std::unique_ptr<const LpmTable> next) {
+        std::lock_guard<std::mutex> lock(publish_);
+        const LpmTable *old = table_.exchange(next.release());
+        uint32_t gen = epoch_.fetch_add(1) & 1;
+        while (readers_[gen].count.load() != 0) {
+            std::this_thread::yield();
+        }
+        delete old;
+    }
+
+  private:
+    struct alignas(64) Readers {
+        std::atomic<uint64_t> count{0};
+    };
+
+    std::atomic<const LpmTable *> table_;
+    std::mutex publish_;
+    alignas(64) std::atomic<uint32_t> epoch_{0};
+    mutable Readers readers_[2];
+};
@@ -2,156 +2,1064 @@
 #include <thread>
 #include <functional>
 #include <condition_variable>
-#include <map>
 #include <string>
 #include <mutex>
 #include <chrono>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <ctime>
+#include <deque>
+#include <memory>
+#include <vector>
 
+#include "include/concurrent_registry.hpp"
+#include "include/job_metrics.hpp"
+
+
+// TimerWheel 클래스 정의
+// 계층형 타이머 휠 (Varghese & Lauck, 리눅스 커널의 예전 타이머 구현과 같은 구조)
+// 256 칸짜리 휠 4단으로 2^32 tick 까지 표현하며, 타이머 추가/취소는 O(1) 입니다.
+// 스레드 안전하지 않으므로 호출하는 쪽(WorkStealingPool)에서 잠금을 잡아야 합니다.
+class TimerWheel {
+public:
+    using Task = std::function<void()>;
+
+    // FixedRate  : 예정 시각 기준으로 주기를 더합니다. 실행 시간과 무관하게 드리프트가 없습니다.
+    // FixedDelay : 실행이 끝난 시각 기준으로 주기를 더합니다. (기존 sleep_for 방식과 동일)
+    enum class Mode { FixedRate, FixedDelay };
+
+    static constexpr uint32_t kNil = UINT32_MAX;
+
+    struct TimerId {
+        uint32_t index = kNil;
+        uint32_t generation = 0;
+        bool valid() const { return index != kNil; }
+    };
+
+    // 만료된 타이머. rearmAfterRun 이 true 이면 실행 후 rearm() 을 호출해야 합니다.
+    // expires 는 실행되어야 했던 tick 입니다.
+    struct Fired {
+        TimerId id;
+        Task task;
+        bool rearmAfterRun;
+        uint64_t expires;
+    };
+
+    TimerWheel() {
+        for (auto &level : slots_) {
+            std::fill(std::begin(level), std::end(level), kNil);
+        }
+    }
+
+    // 다음에 처리할 tick
+    uint64_t now() const { return current_; }
+    size_t size() const { return count_; }
+
+    // expires tick 에 실행될 타이머를 추가합니다. period 가 0 이면 한 번만 실행됩니다.
+    TimerId add(uint64_t expires, uint64_t period, Mode mode, Task task) {
+        uint32_t idx;
+        if (freeHead_ != kNil) {
+            idx = freeHead_;
+            freeHead_ = nodes_[idx].next;
+        } else {
+            idx = static_cast<uint32_t>(nodes_.size());
+            nodes_.emplace_back();
+        }
+        Node &n = nodes_[idx];
+        n.expires = expires;
+        n.period = period;
+        n.mode = mode;
+        n.task = std::move(task);
+        link(idx);
+        ++count_;
+        return TimerId{idx, n.generation};
+    }
+
+    // 타이머를 취소합니다. 이미 실행되었거나 취소된 타이머면 false 를 반환합니다.
+    bool cancel(TimerId id) {
+        if (!alive(id)) {
+            return false;
+        }
+        if (nodes_[id.index].state == Node::State::Linked) {
+            unlink(id.index);
+        }
+        release(id.index);
+        return true;
+    }
+
+    // FixedDelay 타이머의 실행이 끝난 뒤 from tick 기준으로 다음 만료 시각을 지정하고
+    // 그 시각을 반환합니다. 실행 중에 취소되었으면 UINT64_MAX 를 반환합니다.
+    uint64_t rearm(TimerId id, uint64_t from) {
+        if (!alive(id) || nodes_[id.index].state != Node::State::Running) {
+            return UINT64_MAX;
+        }
+        nodes_[id.index].expires = from + nodes_[id.index].period;
+        link(id.index);
+        return nodes_[id.index].expires;
+    }
+
+    // target tick 까지 휠을 돌리며 만료된 타이머를 out 에 모읍니다.
+    void advance(uint64_t target, std::vector<Fired> &out) {
+        while (current_ <= target) {
+            uint32_t idx = current_ & kMask;
+            // 0 번 칸에 도달하면 상위 휠의 한 칸을 하위 휠로 내려보냅니다.
+            if (idx == 0) {
+                for (int level = 1; level < kLevels && cascade(level) == 0; ++level) {
+                }
+            }
+            ++current_;
+
+            uint32_t head = slots_[0][idx];
+            slots_[0][idx] = kNil;
+            occupied_[idx >> 6] &= ~(uint64_t{1} << (idx & 63));
+            while (head != kNil) {
+                uint32_t i = head;
+                head = nodes_[i].next;
+                fire(i, out);
+            }
+        }
+    }
+
+    // 다음에 advance() 로 처리해야 할 tick 을 반환합니다. 타이머가 없으면 UINT64_MAX.
+    uint64_t nextExpiry() const {
+        if (count_ == 0) {
+            return UINT64_MAX;
+        }
+        uint32_t idx = current_ & kMask;
+        if (idx == 0) {
+            return current_;  // 상위 휠을 내려보내야 합니다.
+        }
+        // 이번 회전의 남은 칸 중 첫 번째로 차 있는 칸
+        for (uint32_t word = idx >> 6; word < kSlots / 64; ++word) {
+            uint64_t bits = occupied_[word];
+            if (word == (idx >> 6)) {
+                bits &= ~uint64_t{0} << (idx & 63);
+            }
+            if (bits != 0) {
+                return current_ + (word * 64 + std::countr_zero(bits)) - idx;
+            }
+        }
+        // 없다면 휠이 한 바퀴 돌아 상위 휠을 내려보내는 시점
+        return current_ + (kSlots - idx);
+    }
+
+private:
+    static constexpr int kBits = 8;
+    static constexpr uint32_t kSlots = 1u << kBits;
+    static constexpr uint32_t kMask = kSlots - 1;
+    static constexpr int kLevels = 4;
+    static constexpr uint64_t kMaxDelta = (uint64_t{1} << (kBits * kLevels)) - 1;
+
+    struct Node {
+        enum class State { Free, Linked, Running };
+        uint64_t expires = 0;
+        uint64_t period = 0;
+        Mode mode = Mode::FixedDelay;
+        Task task;
+        uint32_t prev = kNil;
+        uint32_t next = kNil;
+        uint32_t generation = 0;
+        uint8_t level = 0;
+        uint8_t slot = 0;
+        State state = State::Free;
+    };
+
+    bool alive(TimerId id) const {
+        return id.index < nodes_.size() && nodes_[id.index].generation == id.generation &&
+               nodes_[id.index].state != Node::State::Free;
+    }
+
+    void link(uint32_t i) {
+        Node &n = nodes_[i];
+        uint64_t expires = n.expires;
+        uint64_t delta = expires - current_;
+        int level;
+        if (static_cast<int64_t>(delta) < 0) {
+            // 이미 지난 시각이면 다음 tick 에 실행되도록 현재 칸에 넣습니다.
+            level = 0;
+            expires = current_;
+        } else if (delta < (uint64_t{1} << kBits)) {
+            level = 0;
+        } else if (delta < (uint64_t{1} << (2 * kBits))) {
+            level = 1;
+        } else if (delta < (uint64_t{1} << (3 * kBits))) {
+            level = 2;
+        } else {
+            // 표현 범위를 넘어서면 최상위 휠의 끝에 두고, 내려올 때 다시 배치합니다.
+            if (delta > kMaxDelta) {
+                expires = current_ + kMaxDelta;
+            }
+            level = 3;
+        }
+        uint32_t slot = (expires >> (level * kBits)) & kMask;
+
+        n.level = static_cast<uint8_t>(level);
+        n.slot = static_cast<uint8_t>(slot);
+        n.state = Node::State::Linked;
+        n.prev = kNil;
+        n.next = slots_[level][slot];
+        if (n.next != kNil) {
+            nodes_[n.next].prev = i;
+        }
+        slots_[level][slot] = i;
+        if (level == 0) {
+            occupied_[slot >> 6] |= uint64_t{1} << (slot & 63);
+        }
+    }
+
+    void unlink(uint32_t i) {
+        Node &n = nodes_[i];
+        if (n.prev != kNil) {
+            nodes_[n.prev].next = n.next;
+        } else {
+            slots_[n.level][n.slot] = n.next;
+            if (n.level == 0 && n.next == kNil) {
+                occupied_[n.slot >> 6] &= ~(uint64_t{1} << (n.slot & 63));
+            }
+        }
+        if (n.next != kNil) {
+            nodes_[n.next].prev = n.prev;
+        }
+        n.prev = n.next = kNil;
+    }
+
+    void release(uint32_t i) {
+        Node &n = nodes_[i];
+        n.task = nullptr;
+        n.state = Node::State::Free;
+        ++n.generation;  // 예전 TimerId 로는 더 이상 접근할 수 없게 합니다.
+        n.next = freeHead_;
+        freeHead_ = i;
+        --count_;
+    }
+
+    // level 휠의 현재 칸을 하위 휠로 다시 배치하고 그 칸의 인덱스를 반환합니다.
+    uint32_t cascade(int level) {
+        uint32_t idx = (current_ >> (level * kBits)) & kMask;
+        uint32_t head = slots_[level][idx];
+        slots_[level][idx] = kNil;
+        while (head != kNil) {
+            uint32_t i = head;
+            head = nodes_[i].next;
+            link(i);
+        }
+        return idx;
+    }
+
+    void fire(uint32_t i, std::vector<Fired> &out) {
+        Node &n = nodes_[i];
+        TimerId id{i, n.generation};
+        if (n.period == 0) {
+            out.push_back(Fired{id, std::move(n.task), false, n.expires});
+            release(i);
+        } else if (n.mode == Mode::FixedRate) {
+            out.push_back(Fired{id, n.task, false, n.expires});
+            // 예정 시각에 주기를 더하므로 실행이 늦어져도 위상이 밀리지 않습니다.
+            // 이미 놓친 주기는 건너뜁니다.
+            n.expires += n.period;
+            if (n.expires < current_) {
+                n.expires += (current_ - n.expires + n.period - 1) / n.period * n.period;
+            }
+            link(i);
+        } else {
+            out.push_back(Fired{id, n.task, true, n.expires});
+            n.state = Node::State::Running;
+        }
+    }
+
+    std::vector<Node> nodes_;                       // 타이머 노드 (인덱스로 연결)
+    uint32_t freeHead_ = kNil;                      // 빈 노드 리스트
+    uint32_t slots_[kLevels][kSlots];               // 칸별 연결 리스트의 head
+    uint64_t occupied_[kSlots / 64] = {};           // 최하위 휠에서 차 있는 칸
+    uint64_t current_ = 0;                          // 다음에 처리할 tick
+    size_t count_ = 0;                              // 살아 있는 타이머 수
+};
+
+// 주기 작업의 실행 간격
+struct Schedule {
+    std::chrono::milliseconds period{1000};
+    TimerWheel::Mode mode = TimerWheel::Mode::FixedDelay;
+    std::chrono::milliseconds initialDelay{0};
+    bool wallClock = false;               // true 면 initialDelay 대신 벽시계 격자에 맞춥니다.
+    std::chrono::milliseconds offset{0};  // 벽시계 격자: period 의 배수 + offset
+
+    // 실행이 끝난 뒤 period 만큼 쉬고 다시 실행합니다.
+    static Schedule fixedDelay(std::chrono::milliseconds period) {
+        return Schedule{period, TimerWheel::Mode::FixedDelay};
+    }
+
+    // 시작 시각을 기준으로 period 마다 실행합니다.
+    static Schedule fixedRate(std::chrono::milliseconds period) {
+        return Schedule{period, TimerWheel::Mode::FixedRate};
+    }
+
+    // cron 처럼 벽시계 기준으로 정렬된 시각(period 의 배수 + offset)마다 실행합니다.
+    // 예: aligned(std::chrono::minutes(1)) 은 매 분 0초에 실행됩니다.
+    // 격자까지 남은 시간은 만들 때가 아니라 예약할 때마다(start, resume) firstDelay() 로
+    // 다시 계산하므로, 나중에 시작하거나 재개해도 격자에서 벗어나지 않습니다.
+    static Schedule aligned(std::chrono::milliseconds period,
+                            std::chrono::milliseconds offset = std::chrono::milliseconds(0)) {
+        Schedule s{period, TimerWheel::Mode::FixedRate};
+        s.wallClock = true;
+        s.offset = offset;
+        return s;
+    }
+
+    // 지금 예약하면 첫 실행까지 기다릴 시간입니다.
+    // wallClock 이면 벽시계(system_clock) 기준으로 다음 격자까지 남은 시간입니다.
+    std::chrono::milliseconds firstDelay() const {
+        if (!wallClock) {
+            return initialDelay;
+        }
+        auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch());
+        auto wait = (offset - now) % period;
+        if (wait < std::chrono::milliseconds(0)) {
+            wait += period;
+        }
+        return wait;
+    }
+};
+
+
+// WorkStealingPool 클래스 정의
+// 고정된 개수(기본: 코어 수)의 워커 스레드 위에 모든 작업을 다중화합니다.
+// 각 워커는 자신의 deque 를 가지며, 자신의 deque 가 비면 다른 워커의 deque 에서
+// 작업을 훔쳐(steal) 실행합니다.
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+    using Clock = std::chrono::steady_clock;
+
+    explicit WorkStealingPool(size_t numWorkers = std::thread::hardware_concurrency())
+    {
+        if (numWorkers == 0) {
+            numWorkers = 1;
+        }
+        for (size_t i = 0; i < numWorkers; ++i) {
+            workers_.emplace_back(std::make_unique<Worker>());
+        }
+        // 모든 deque 가 만들어진 뒤에 스레드를 띄워야 steal 시 범위를 벗어나지 않습니다.
+        for (size_t i = 0; i < numWorkers; ++i) {
+            threads_.emplace_back([this, i](std::stop_token st) { this->workerLoop(i, st); });
+        }
+        timerThread_ = std::jthread([this](std::stop_token st) { this->timerLoop(st); });
+    }
+
+    // 소멸자: 남아 있는 작업은 실행하지 않고 버린 뒤 워커들을 종료합니다.
+    ~WorkStealingPool() {
+        timerThread_.request_stop();
+        for (auto &t : threads_) {
+            t.request_stop();
+        }
+        // jthread 소멸 시 자동으로 조인됩니다.
+        timerThread_ = std::jthread();
+        threads_.clear();
+    }
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    // 프로세스 전체에서 공유하는 기본 풀
+    static WorkStealingPool &instance() {
+        static WorkStealingPool pool;
+        return pool;
+    }
+
+    size_t size() const { return workers_.size(); }
+
+    // 작업 제출: 워커 스레드에서 호출하면 자신의 deque 에, 외부에서 호출하면
+    // 라운드 로빈으로 고른 워커의 deque 에 넣습니다.
+    void submit(Task task) {
+        size_t idx = (currentPool_ == this)
+                         ? currentIndex_
+                         : next_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+        {
+            std::lock_guard<std::mutex> lock(workers_[idx]->mutex);
+            workers_[idx]->tasks.push_back(Queued{std::move(task), Clock::now()});
+        }
+        queued_.fetch_add(1, std::memory_order_release);
+        {
+            // 워커가 프레디케이트 평가와 wait 사이에서 알림을 놓치지 않도록 잠깐 잠급니다.
+            std::lock_guard<std::mutex> lock(idleMutex_);
+        }
+        idleCv_.notify_one();
+    }
+
+    // 여러 작업을 한 번에 제출합니다. 워커별로 한 번씩만 잠그고 한 번에 깨웁니다.
+    void submitBatch(std::vector<Task> &tasks) {
+        Clock::time_point now = Clock::now();
+        std::vector<Queued> batch;
+        batch.reserve(tasks.size());
+        for (Task &task : tasks) {
+            batch.push_back(Queued{std::move(task), now});
+        }
+        tasks.clear();
+        submitQueued(batch);
+    }
+
+    // 지금 워커에서 실행 중인 작업이 실행되었어야 할 시각입니다.
+    // submit() 으로 들어온 작업은 제출한 시각, 예약 작업은 타이머가 만료된 시각입니다.
+    // 이 시각부터 실제 시작까지가 큐/깨우기 지연입니다.
+    static Clock::time_point dueTime() { return currentDue_; }
+
+    // 지금 워커에서 실행 중인 작업을 제출한 타이머입니다. submit() 으로 들어온 작업이면
+    // 비어 있습니다. 주기 작업이 스스로를 cancel() 할 때 씁니다.
+    static TimerWheel::TimerId currentTimer() { return currentTimer_; }
+
+    // delay 이후에 작업을 제출합니다. 대기하는 동안 워커를 점유하지 않습니다.
+    TimerWheel::TimerId submitAfter(Clock::duration delay, Task task) {
+        std::lock_guard<std::mutex> lock(timerMutex_);
+        TimerWheel::TimerId id = wheel_.add(toTicks(Clock::now() + delay), 0,
+                                            TimerWheel::Mode::FixedDelay, std::move(task));
+        wakeTimerLocked(toTicks(Clock::now() + delay));
+        return id;
+    }
+
+    // schedule 에 따라 task 를 주기적으로 제출합니다. cancel() 로 중단합니다.
+    TimerWheel::TimerId schedule(const Schedule &schedule, Task task) {
+        uint64_t period = std::max<uint64_t>(1, toTicks(schedule.period));
+        uint64_t expires = toTicks(Clock::now() + schedule.firstDelay());
+        std::lock_guard<std::mutex> lock(timerMutex_);
+        TimerWheel::TimerId id = wheel_.add(expires, period, schedule.mode, std::move(task));
+        wakeTimerLocked(expires);
+        return id;
+    }
+
+    // 예약된 작업을 취소합니다. 이미 워커에 제출된 실행은 취소되지 않습니다.
+    bool cancel(TimerWheel::TimerId id) {
+        std::lock_guard<std::mutex> lock(timerMutex_);
+        return wheel_.cancel(id);
+    }
+
+private:
+    static constexpr std::chrono::milliseconds kTick{1};  // 타이머 휠 해상도
+    static constexpr size_t kSpinRounds = 4;   // steal 경합 시 pause 로 기다리는 횟수
+    static constexpr size_t kYieldRounds = 4;  // 그 다음 yield 하는 횟수
+
+    // 큐에 들어간 작업과 실행되었어야 할 시각
+    struct Queued {
+        Task task;
+        Clock::time_point due;
+        TimerWheel::TimerId timer{};
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Queued> tasks;
+    };
+
+    void submitQueued(std::vector<Queued> &tasks) {
+        if (tasks.empty()) {
+            return;
+        }
+        size_t n = workers_.size();
+        size_t first = next_.fetch_add(tasks.size(), std::memory_order_relaxed);
+        for (size_t w = 0; w < n && w < tasks.size(); ++w) {
+            Worker &worker = *workers_[(first + w) % n];
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            for (size_t i = w; i < tasks.size(); i += n) {
+                worker.tasks.push_back(std::move(tasks[i]));
+            }
+        }
+        queued_.fetch_add(tasks.size(), std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(idleMutex_);
+        }
+        if (tasks.size() == 1) {
+            idleCv_.notify_one();
+        } else {
+            idleCv_.notify_all();
+        }
+        tasks.clear();
+    }
+
+    // 시각을 풀 생성 시점 기준의 tick 으로 올림 변환합니다.
+    uint64_t toTicks(Clock::time_point tp) const {
+        return tp <= epoch_ ? 0 : toTicks(tp - epoch_);
+    }
+
+    static uint64_t toTicks(Clock::duration d) {
+        return static_cast<uint64_t>((d + kTick - Clock::duration(1)) / kTick);
+    }
+
+    // 타이머 스레드가 expires 보다 늦게까지 잠들어 있다면 깨웁니다.
+    void wakeTimerLocked(uint64_t expires) {
+        if (expires < sleepUntil_) {
+            sleepUntil_ = expires;
+            timerWake_ = true;
+            timerCv_.notify_one();
+        }
+    }
+
+    // 자신의 deque 뒤쪽(LIFO)에서 꺼냅니다. 캐시에 남아 있는 작업을 먼저 처리합니다.
+    bool popLocal(size_t idx, Queued &task) {
+        Worker &w = *workers_[idx];
+        std::lock_guard<std::mutex> lock(w.mutex);
+        if (w.tasks.empty()) {
+            return false;
+        }
+        task = std::move(w.tasks.back());
+        w.tasks.pop_back();
+        return true;
+    }
+
+    // 다른 워커의 deque 앞쪽(FIFO)에서 훔쳐옵니다.
+    // block 이 false 면 잠겨 있는 deque 는 건너뛰고 contended 를 표시합니다.
+    bool steal(size_t idx, Queued &task, bool block, bool &contended) {
+        for (size_t i = 1; i < workers_.size(); ++i) {
+            Worker &victim = *workers_[(idx + i) % workers_.size()];
+            std::unique_lock<std::mutex> lock(victim.mutex, std::defer_lock);
+            if (block) {
+                lock.lock();
+            } else if (!lock.try_lock()) {
+                contended = true;
+                continue;
+            }
+            if (victim.tasks.empty()) {
+                continue;
+            }
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+        return false;
+    }
+
+    static void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+
+    // 경합으로 훔치지 못한 round 번째 재시도 전에 쉽니다.
+    // 처음에는 pause 를 점점 길게, 그 다음에는 yield 로 코어를 양보합니다.
+    static void backoff(size_t round) {
+        if (round < kSpinRounds) {
+            for (size_t i = 0; i < (size_t{16} << round); ++i) {
+                cpuRelax();
+            }
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    void workerLoop(size_t idx, std::stop_token stopToken) {
+        currentPool_ = this;
+        currentIndex_ = idx;
+        size_t misses = 0;  // 경합 때문에 연달아 훔치지 못한 횟수
+        while (!stopToken.stop_requested()) {
+            Queued task;
+            bool contended = false;
+            bool block = misses >= kSpinRounds + kYieldRounds;
+            if (popLocal(idx, task) || steal(idx, task, block, contended)) {
+                misses = 0;
+                queued_.fetch_sub(1, std::memory_order_relaxed);
+                currentDue_ = task.due;
+                currentTimer_ = task.timer;
+                task.task();
+                continue;
+            }
+            // 잠긴 deque 에 작업이 남아 있을 수 있어 잠들 수는 없지만, 바로 다시 돌면
+            // 코어를 태웁니다. 잠깐 쉬었다가 재시도하고, 계속 경합하면 다음에는
+            // 잠금을 기다려서(futex 에서 잠들어) 훔칩니다.
+            if (contended) {
+                backoff(misses++);
+                continue;
+            }
+            misses = 0;
+            // 실행할 작업이 없으면 새 작업이 제출될 때까지 잠듭니다.
+            std::unique_lock<std::mutex> lock(idleMutex_);
+            idleCv_.wait(lock, stopToken, [this]() {
+                return queued_.load(std::memory_order_acquire) > 0;
+            });
+        }
+    }
+
+    // 타이머 휠을 돌리며 만료된 작업들을 한 번에 워커 deque 로 옮깁니다.
+    void timerLoop(std::stop_token stopToken) {
+        std::vector<TimerWheel::Fired> fired;
+        std::vector<Queued> batch;
+        std::unique_lock<std::mutex> lock(timerMutex_);
+        while (!stopToken.stop_requested()) {
+            // 지난 tick 까지만 처리하므로 타이머가 예정보다 일찍 실행되지 않습니다.
+            wheel_.advance(static_cast<uint64_t>((Clock::now() - epoch_) / kTick), fired);
+            if (!fired.empty()) {
+                for (auto &f : fired) {
+                    Clock::time_point due = epoch_ + f.expires * kTick;
+                    if (f.rearmAfterRun) {
+                        // FixedDelay: 실행이 끝난 시각을 기준으로 다시 예약합니다.
+                        batch.push_back(Queued{[this, id = f.id, task = std::move(f.task)]() {
+                            task();
+                            std::lock_guard<std::mutex> lock(timerMutex_);
+                            uint64_t expires = wheel_.rearm(id, toTicks(Clock::now()));
+                            if (expires != UINT64_MAX) {
+                                wakeTimerLocked(expires);
+                            }
+                        }, due, f.id});
+                    } else {
+                        batch.push_back(Queued{std::move(f.task), due, f.id});
+                    }
+                }
+                fired.clear();
+                lock.unlock();
+                submitQueued(batch);
+                lock.lock();
+                continue;
+            }
+
+            sleepUntil_ = wheel_.nextExpiry();
+            timerWake_ = false;
+            if (sleepUntil_ == UINT64_MAX) {
+                timerCv_.wait(lock, stopToken, [this]() { return timerWake_; });
+            } else {
+                timerCv_.wait_until(lock, stopToken, epoch_ + sleepUntil_ * kTick,
+                                    [this]() { return timerWake_; });
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<Worker>> workers_;   // 워커별 deque
+    std::vector<std::jthread> threads_;              // 워커 스레드
+    std::atomic<size_t> next_{0};                    // 외부 제출용 라운드 로빈 인덱스
+    std::atomic<size_t> queued_{0};                  // 모든 deque 에 쌓인 작업 수
+    std::mutex idleMutex_;                           // 유휴 워커 대기용 뮤텍스
+    std::condition_variable_any idleCv_;             // 유휴 워커 대기용 조건 변수
+
+    std::mutex timerMutex_;                          // 예약 작업 뮤텍스
+    std::condition_variable_any timerCv_;            // 예약 작업 조건 변수
+    TimerWheel wheel_;                               // 예약 작업 타이머 휠
+    Clock::time_point epoch_ = Clock::now();         // tick 0 의 시각
+    uint64_t sleepUntil_ = UINT64_MAX;               // 타이머 스레드가 깨어날 tick
+    bool timerWake_ = false;                         // 타이머 스레드 조기 기상 요청
+    std::jthread timerThread_;                       // 예약 작업 스레드
+
+    static thread_local WorkStealingPool *currentPool_;
+    static thread_local size_t currentIndex_;
+    static thread_local Clock::time_point currentDue_;
+    static thread_local TimerWheel::TimerId currentTimer_;
+};
+
+thread_local WorkStealingPool *WorkStealingPool::currentPool_ = nullptr;
+thread_local size_t WorkStealingPool::currentIndex_ = 0;
+thread_local WorkStealingPool::Clock::time_point WorkStealingPool::currentDue_;
+thread_local TimerWheel::TimerId WorkStealingPool::currentTimer_;
 
 // ThreadController 클래스 정의
+// 작업마다 스레드를 만들지 않고 공유 WorkStealingPool 위에서 실행됩니다.
+// 실행 중인 작업은 풀의 타이머 휠에 schedule_ 주기로 등록되고,
+// 만료될 때마다 func_() 한 번이 풀의 워커에서 실행됩니다.
+// 실행/일시 중지/종료 상태는 하나의 atomic 상태 워드에 모여 있어
+// 제어 함수와 tick 모두 뮤텍스를 잡지 않습니다.
+// 실행 횟수, 실행 시간, 깨어나기까지의 지연, 일시 중지 시간, 주기 초과는
+// JobMetricsRegistry::global() 에 name 으로 기록됩니다.
 class ThreadController {
 public:
-    // 생성자: lambda 함수를 받아 초기화하고 스레드를 시작합니다.
-    ThreadController(std::function<void()> func)
-        : func_(func), running_(false), paused_(false), terminate_(false)
+    // 생성자: 이름, lambda 함수와 실행 주기를 받아 초기화합니다. 스레드는 만들지 않습니다.
+    // 기본 주기는 기존 동작과 같이 "실행 후 1초 대기" 입니다.
+    ThreadController(std::string name, std::function<void()> func,
+                     Schedule schedule = Schedule::fixedDelay(std::chrono::milliseconds(1000)),
+                     WorkStealingPool &pool = WorkStealingPool::instance())
+        : state_(std::make_shared<State>(std::move(name), std::move(func), schedule, pool))
     {
-        // jthread는 자동으로 스레드를 관리하며, 소멸 시 자동으로 조인(join)됩니다.
-        // 람다를 사용하여 this 포인터를 캡처하고 threadFunc를 호출합니다.
-        worker_ = std::jthread([this](std::stop_token st) { this->threadFunc(st); });
     }
 
-    // 소멸자: 스레드를 종료시킵니다.
+    // 이름이 없으면 "controller-<번호>" 로 기록됩니다.
+    ThreadController(std::function<void()> func,
+                     Schedule schedule = Schedule::fixedDelay(std::chrono::milliseconds(1000)),
+                     WorkStealingPool &pool = WorkStealingPool::instance())
+        : ThreadController(defaultName(), std::move(func), schedule, pool)
+    {
+    }
+
+    // 소멸자: 타이머를 취소하고, 실행 중인 func_() 가 있으면 끝날 때까지 기다립니다.
+    // 이미 풀에 제출된 tick 은 state_ 를 공유하므로 실행되더라도 바로 반환됩니다.
     ~ThreadController() {
-        {
-            std::lock_guard<std::mutex> lock(mutex_);
-            terminate_ = true;
-            cv_.notify_all();
+        int64_t since = 0;
+        if (state_->transition([](uint32_t s) { return !(s & State::kTerminate); },
+                               [&](uint32_t s) {
+                                   since = state_->pausedSince(s);
+                                   return s | State::kTerminate;
+                               })) {
+            state_->disarm();
+            state_->unpaused(since);
+        }
+
+        // 실행 중이면 kWaiter 를 표시하고 tick 이 notify 할 때까지 기다립니다. (futex)
+        uint32_t cur = state_->word_.load(std::memory_order_acquire);
+        while (cur & State::kExecuting) {
+            if (!(cur & State::kWaiter) &&
+                !state_->word_.compare_exchange_weak(cur, cur | State::kWaiter,
+                                                     std::memory_order_acq_rel)) {
+                continue;
+            }
+            state_->word_.wait(cur | State::kWaiter, std::memory_order_acquire);
+            cur = state_->word_.load(std::memory_order_acquire);
         }
-        // jthread는 소멸 시 자동으로 스레드를 종료합니다.
     }
 
     // 스레드 시작 함수
     void start() {
-        std::lock_guard<std::mutex> lock(mutex_);
-        if (!running_ && !terminate_) {
-            running_ = true;
-            paused_ = false;
-            cv_.notify_all();
+        if (state_->transition(
+                [](uint32_t s) { return !(s & (State::kRunning | State::kTerminate)); },
+                [](uint32_t s) { return (s & ~State::kPaused) | State::kRunning; })) {
+            State::armIfIdle(state_);
         }
     }
 
     // 스레드 중지 함수
     void stop() {
-        std::lock_guard<std::mutex> lock(mutex_);
-        running_ = false;
-        paused_ = false;
-        cv_.notify_all();
+        int64_t since = 0;
+        if (state_->transition(
+                [](uint32_t s) { return (s & State::kRunning) != 0; },
+                [&](uint32_t s) {
+                    since = state_->pausedSince(s);
+                    return s & ~(State::kRunning | State::kPaused);
+                })) {
+            state_->unpaused(since);
+        }
     }
 
     // 스레드 일시 중지 함수
     void pause() {
-        std::lock_guard<std::mutex> lock(mutex_);
-        if (running_ && !paused_) {
-            paused_ = true;
-        }
+        // 시각은 kPaused 를 게시하는 CAS 보다 먼저 기록해야 resume() 이 읽을 수 있습니다.
+        state_->transition(
+            [](uint32_t s) { return (s & (State::kRunning | State::kPaused)) == State::kRunning; },
+            [this](uint32_t s) {
+                state_->pausedAt_.store(std::chrono::steady_clock::now().time_since_epoch().count(),
+                                        std::memory_order_relaxed);
+                return s | State::kPaused;
+            });
     }
 
     // 스레드 재개 함수
     void resume() {
-        std::lock_guard<std::mutex> lock(mutex_);
-        if (running_ && paused_) {
-            paused_ = false;
-            cv_.notify_all();
+        int64_t since = 0;
+        if (state_->transition(
+                [](uint32_t s) {
+                    return (s & (State::kRunning | State::kPaused | State::kTerminate)) ==
+                           (State::kRunning | State::kPaused);
+                },
+                [&](uint32_t s) {
+                    since = state_->pausedSince(s);
+                    return s & ~State::kPaused;
+                })) {
+            state_->unpaused(since);
+            State::armIfIdle(state_);
         }
     }
 
 private:
-    // 스레드에서 실행될 함수
-    void threadFunc(std::stop_token stopToken) {
-        while (true) {
-            std::unique_lock<std::mutex> lock(mutex_);
-            // cv.wait 동작 방식
-            // 조건 변수 대기:
-            //   wait 함수가 호출되면, 현재 스레드는 대기 상태로 전환됩니다.
-            //   이때, 뮤텍스는 자동으로 해제되어 다른 스레드가 공유 자원에 접근할 수 있게 됩니다.
-            // 알림 수신:
-            //   다른 스레드가 notify_one() 또는 notify_all()을 호출하여 조건 변수를 알립니다.
-            //   스레드는 깨워지지만, 즉시 실행되지 않고 다시 뮤텍스를 잠그고 프레디케이트평가 합니다.
-            // 프레디케이트 평가:
-            //   wait 함수는 프레디케이트를 호출하여 조건을 평가합니다.
-            //   프레디케이트가 true를 반환하면, wait 함수는 반환되고 스레드는 실행을 계속합니다.(뮤텍스는 잠긴 상태)
-            //   프레디케이트가 false를 반환하면, 스레드는 다시 대기 상태로 전환되며, 뮤텍스는 해제됩니다. (계속 대시)
-            // 조건 변수 대기: running_ 이고 paused_ 가 아니며, 종료 요청이 없을 때 실행
-            cv_.wait(lock, [this, &stopToken]() {
-                return (running_ && !paused_) || terminate_ || stopToken.stop_requested();
-            });
+    static std::string defaultName() {
+        static std::atomic<uint64_t> seq{0};
+        return "controller-" + std::to_string(seq.fetch_add(1, std::memory_order_relaxed));
+    }
+
+    // 풀에 제출된 tick 이 ThreadController 보다 오래 살 수 있으므로
+    // 작업 상태는 shared_ptr 로 공유합니다.
+    //
+    // pause()/stop() 은 타이머를 취소하지 않고 상태 워드만 바꿉니다. 타이머는 다음 tick 이
+    // 실행할 수 없는 상태를 보고 스스로 물러나며, start()/resume() 은 남아 있는 타이머를
+    // 그대로 이어 씁니다. 그래서 주기보다 자주 토글되는 작업은 풀의 타이머 잠금을 잡지
+    // 않고, 그렇지 않더라도 주기마다 많아야 한 번만 다시 등록합니다.
+    struct State {
+        static constexpr uint32_t kRunning = 1u << 0;    // 스레드 실행 상태
+        static constexpr uint32_t kPaused = 1u << 1;     // 스레드 일시 중지 상태
+        static constexpr uint32_t kTerminate = 1u << 2;  // 종료 신호
+        static constexpr uint32_t kExecuting = 1u << 3;  // func_() 실행 중 여부
+        static constexpr uint32_t kWaiter = 1u << 4;     // 소멸자가 kExecuting 해제를 기다리는 중
+
+        State(std::string name, std::function<void()> func, Schedule schedule,
+              WorkStealingPool &pool)
+            : func_(std::move(func)), schedule_(schedule), pool_(pool),
+              metrics_(JobMetricsRegistry::global().add(std::move(name))) {}
+
+        // 상태 s 가 일시 중지였으면 pause() 한 시각을, 아니면 0 을 돌려줍니다.
+        // 전이 CAS 직전에 읽어야 그 뒤의 새 pause() 가 기록한 시각과 섞이지 않습니다.
+        int64_t pausedSince(uint32_t s) const {
+            return (s & kPaused) ? pausedAt_.load(std::memory_order_relaxed) : 0;
+        }
 
-            // 종료 신호가 오면 루프를 빠져나감
-            if (stopToken.stop_requested() || terminate_) {
-                break;
+        // 일시 중지가 풀렸으면 중지되어 있던 시간을 기록합니다.
+        void unpaused(int64_t since) {
+            if (since != 0) {
+                auto now = std::chrono::steady_clock::now().time_since_epoch();
+                metrics_.recordPaused(now - std::chrono::steady_clock::duration(since));
             }
+        }
 
-            // mutext_가 잠겨있으므로 해제해주어야 한다.
-            lock.unlock();
+        static bool runnable(uint32_t s) {
+            return (s & (kRunning | kPaused | kTerminate)) == kRunning;
+        }
+
+        // allowed(s) 가 참이면 apply(s) 로 바꿉니다. (CAS 루프)
+        // armIfIdle()/retire() 와 엇갈려도 한쪽은 다른 쪽의 쓰기를 보도록 seq_cst 로 바꿉니다.
+        template <typename Allowed, typename Apply>
+        bool transition(Allowed allowed, Apply apply) {
+            uint32_t cur = word_.load(std::memory_order_acquire);
+            uint32_t next;
+            do {
+                if (!allowed(cur)) {
+                    return false;
+                }
+                next = apply(cur);
+            } while (!word_.compare_exchange_weak(cur, next, std::memory_order_seq_cst));
+            return true;
+        }
+
+        // 실행 가능한 상태로 바꾼 뒤 호출합니다. 등록된 타이머가 없을 때만 새로 등록합니다.
+        // tick 이 물러나는 것과 엇갈리면 양쪽 모두 등록을 시도할 수 있지만, timer_ 를
+        // 먼저 차지한 쪽만 남습니다.
+        static void armIfIdle(const std::shared_ptr<State> &self) {
+            if (self->timer_.load(std::memory_order_seq_cst) != kNoTimer) {
+                return;
+            }
+            TimerWheel::TimerId id =
+                self->pool_.schedule(self->schedule_, [self]() { tick(self); });
+            uint64_t expected = kNoTimer;
+            if (!self->timer_.compare_exchange_strong(expected, pack(id),
+                                                      std::memory_order_acq_rel)) {
+                self->pool_.cancel(id);
+            }
+        }
+
+        // 타이머를 취소합니다. 소멸자에서 호출합니다.
+        void disarm() {
+            uint64_t cur = timer_.exchange(kNoTimer, std::memory_order_acq_rel);
+            if (cur != kNoTimer) {
+                pool_.cancel(unpack(cur));
+            }
+        }
+
+        // 실행할 수 없는 상태를 본 tick 이 자기 타이머를 거둡니다. 그 사이에 resume() 이
+        // 있었는데 그쪽은 아직 타이머가 남아 있다고 봤다면, 여기서 다시 등록합니다.
+        static void retire(const std::shared_ptr<State> &self, TimerWheel::TimerId id) {
+            uint64_t mine = pack(id);
+            if (!self->timer_.compare_exchange_strong(mine, kNoTimer, std::memory_order_seq_cst)) {
+                return;
+            }
+            self->pool_.cancel(id);
+            if (runnable(self->word_.load(std::memory_order_seq_cst))) {
+                armIfIdle(self);
+            }
+        }
+
+        // 풀의 워커에서 실행될 함수
+        static void tick(const std::shared_ptr<State> &self) {
+            // 취소되기 전에 이미 워커로 넘어간 실행이면 무시합니다.
+            TimerWheel::TimerId id = WorkStealingPool::currentTimer();
+            if (self->timer_.load(std::memory_order_acquire) != pack(id)) {
+                return;
+            }
+
+            uint32_t cur = self->word_.load(std::memory_order_acquire);
+            do {
+                // running_ 이고 paused_ 가 아니며, 종료 요청이 없을 때만 실행
+                // FixedRate 에서 이전 실행이 아직 끝나지 않았다면 이번 주기는 건너뜁니다.
+                if (!runnable(cur)) {
+                    retire(self, id);
+                    return;
+                }
+                if (cur & kExecuting) {
+                    self->metrics_.recordSkipped();
+                    return;
+                }
+            } while (!self->word_.compare_exchange_weak(cur, cur | kExecuting,
+                                                        std::memory_order_acq_rel));
 
             // Lambda 함수 실행
-            func_();
+            auto start = std::chrono::steady_clock::now();
+            self->func_();
+            auto run = std::chrono::steady_clock::now() - start;
+            self->metrics_.recordRun(run, start - WorkStealingPool::dueTime(),
+                                     run > self->schedule_.period);
 
-            // CPU 과부하를 방지하기 위해 잠시 대기
-            std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+            uint32_t prev = self->word_.fetch_and(~(kExecuting | kWaiter), std::memory_order_acq_rel);
+            if (prev & kWaiter) {
+                self->word_.notify_all();
+            }
         }
-    }
 
-    std::function<void()> func_;           // 실행할 lambda 함수
-    std::jthread worker_;                  // jthread 객체
-    std::mutex mutex_;                     // 뮤텍스
-    std::condition_variable cv_;           // 조건 변수
-    bool running_;                         // 스레드 실행 상태
-    bool paused_;                          // 스레드 일시 중지 상태
-    bool terminate_;                       // 종료 신호
+        static constexpr uint64_t kNoTimer = TimerWheel::kNil;  // 빈 TimerId 를 pack 한 값
+
+        static uint64_t pack(TimerWheel::TimerId id) {
+            return (uint64_t{id.generation} << 32) | id.index;
+        }
+
+        static TimerWheel::TimerId unpack(uint64_t v) {
+            return TimerWheel::TimerId{static_cast<uint32_t>(v), static_cast<uint32_t>(v >> 32)};
+        }
+
+        std::function<void()> func_;                      // 실행할 lambda 함수
+        Schedule schedule_;                               // 실행 주기
+        WorkStealingPool &pool_;                          // 작업을 실행할 풀
+        std::atomic<uint32_t> word_{0};                   // 상태 워드 (플래그)
+        std::atomic<uint64_t> timer_{kNoTimer};           // 등록된 타이머 (pack 된 TimerId)
+        JobMetrics metrics_;                              // 작업별 지표
+        std::atomic<int64_t> pausedAt_{0};                // 마지막 pause() 한 시각 (steady_clock)
+    };
+
+    std::shared_ptr<State> state_;
 };
 
-int main() {
-    // 스레드를 관리할 map 생성 (값을 unique_ptr으로 변경)
-    std::map<std::string, std::unique_ptr<ThreadController>> threads;
+// 제어 평면 마이크로벤치마크
+// controllers 개의 작업을 1ms FixedRate 로 돌리면서 togglers 개의 스레드가 동시에
+// pause()/resume() 을 반복합니다. 제어 호출 지연과 tick 한 번당 CPU 비용을 출력합니다.
+int runControlBenchmark(size_t controllers, size_t togglers, std::chrono::seconds duration) {
+    auto cpuNow = []() {
+        timespec ts;
+        clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+        return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+    };
+
+    std::atomic<uint64_t> iterations{0};
+    std::vector<std::unique_ptr<ThreadController>> jobs;
+    for (size_t i = 0; i < controllers; ++i) {
+        jobs.emplace_back(std::make_unique<ThreadController>(
+            [&iterations]() { iterations.fetch_add(1, std::memory_order_relaxed); },
+            Schedule::fixedRate(std::chrono::milliseconds(1))));
+        jobs.back()->start();
+    }
+
+    for (size_t phase = 0; phase < 2; ++phase) {
+        size_t threads = (phase == 0) ? 0 : togglers;
+        std::atomic<bool> done{false};
+        std::vector<std::vector<uint64_t>> latencies(threads);
+        std::vector<std::jthread> workers;
+        iterations = 0;
+        auto cpuStart = cpuNow();
+        for (size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t]() {
+                auto &lat = latencies[t];
+                for (size_t i = t; !done.load(std::memory_order_relaxed); i += threads) {
+                    ThreadController &job = *jobs[i % jobs.size()];
+                    auto begin = std::chrono::steady_clock::now();
+                    job.pause();
+                    job.resume();
+                    auto end = std::chrono::steady_clock::now();
+                    lat.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() / 2);
+                }
+            });
+        }
+        std::this_thread::sleep_for(duration);
+        done = true;
+        workers.clear();
+        auto cpu = cpuNow() - cpuStart;
+
+        std::vector<uint64_t> all;
+        for (auto &lat : latencies) {
+            all.insert(all.end(), lat.begin(), lat.end());
+        }
+        uint64_t iters = iterations.load();
+        std::cout << "[" << (threads ? "toggling" : "steady") << "] controllers=" << controllers
+                  << " togglers=" << threads << " iterations=" << iters << " cpu/iteration="
+                  << (iters ? std::chrono::duration_cast<std::chrono::nanoseconds>(cpu).count() / iters : 0)
+                  << "ns";
+        if (!all.empty()) {
+            std::sort(all.begin(), all.end());
+            uint64_t sum = 0;
+            for (auto v : all) {
+                sum += v;
+            }
+            std::cout << " control calls=" << all.size() << " avg=" << sum / all.size()
+                      << "ns p50=" << all[all.size() / 2] << "ns p99=" << all[all.size() * 99 / 100]
+                      << "ns";
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    // ./thread_manager --bench [controllers] [togglers]
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        size_t controllers = argc > 2 ? std::stoul(argv[2]) : 4096;
+        size_t togglers = argc > 3 ? std::stoul(argv[3]) : 4;
+        return runControlBenchmark(controllers, togglers, std::chrono::seconds(2));
+    }
+
+    // 스레드를 관리할 레지스트리 생성
+    // 여러 스레드에서 동시에 조회/등록/해제해도 안전하며, 조회는 잠금을 잡지 않습니다.
+    ConcurrentRegistry<ThreadController> threads;
 
     // 예제용 lambda 함수 정의
     auto lambda = [](){
         std::cout << "Thread is running..." << std::endl;
     };
 
-    // unique_ptr를 사용하여 ThreadController 객체를 동적으로 할당하고 map에 삽입
-    threads.emplace("thread1", std::make_unique<ThreadController>(lambda));
+    // shared_ptr를 사용하여 ThreadController 객체를 동적으로 할당하고 레지스트리에 등록
+    threads.insert("thread1", std::make_shared<ThreadController>("thread1", lambda));
+
+    // 자주 조회하는 이름은 해시를 미리 계산해 둘 수 있습니다.
+    const auto thread1 = ConcurrentRegistry<ThreadController>::key("thread1");
 
     // 삽입된 스레드 시작
     std::cout << "Starting thread1..." << std::endl;
-    threads["thread1"]->start();
+    threads.find(thread1)->start();
 
     // 스레드가 실행되는 동안 대기 (예: 2초)
     std::this_thread::sleep_for(std::chrono::seconds(2));
 
     // 스레드 일시 중지
     std::cout << "Pausing thread1..." << std::endl;
-    threads["thread1"]->pause();
+    threads.find(thread1)->pause();
 
     // 일시 중지 상태에서 대기 (예: 2초)
     std::this_thread::sleep_for(std::chrono::seconds(2));
 
     // 스레드 재개
     std::cout << "Resuming thread1..." << std::endl;
-    threads["thread1"]->resume();
+    threads.find(thread1)->resume();
 
     // 스레드가 다시 실행되는 동안 대기 (예: 2초)
     std::this_thread::sleep_for(std::chrono::seconds(2));
 
     // 스레드 중지
     std::cout << "Stopping thread1..." << std::endl;
-    threads["thread1"]->stop();
+    threads.find(thread1)->stop();
 
     // 추가적인 작업을 위해 잠시 대기 (예: 1초)
     std::this_thread::sleep_for(std::chrono::seconds(1));
 
-    // 프로그램 종료 시, unique_ptr가 자동으로 ThreadController를 소멸시킵니다.
+    // 여러 개의 컨트롤러를 등록해도 OS 스레드는 풀의 워커 수만큼만 사용합니다.
+    for (int i = 0; i < 200; ++i) {
+        auto controller = std::make_shared<ThreadController>("job" + std::to_string(i), []() {});
+        controller->start();
+        threads.insert("job" + std::to_string(i), std::move(controller));
+    }
+    // 작업마다 주기와 방식을 지정할 수 있습니다.
+    threads.insert("fast", std::make_shared<ThreadController>(
+                               "fast", []() { std::cout << "fast job" << std::endl; },
+                               Schedule::fixedRate(std::chrono::milliseconds(500))));
+    threads.visit("fast", [](const auto &controller) { controller->start(); });
+    std::cout << "Controllers: " << threads.size()
+              << ", pool workers: " << WorkStealingPool::instance().size() << std::endl;
+    std::this_thread::sleep_for(std::chrono::seconds(2));
+
+    // 작업별 지표. --metrics 를 주면 Prometheus 텍스트 형식 전체를 출력합니다.
+    if (argc > 1 && std::string(argv[1]) == "--metrics") {
+        std::cout << JobMetricsRegistry::global().prometheus();
+    } else {
+        for (const auto &job : JobMetricsRegistry::global().snapshot()) {
+            if (job.name != "thread1" && job.name != "fast") {
+                continue;
+            }
+            std::cout << job.name << ": runs=" << job.runs << " skipped=" << job.skipped
+                      << " overruns=" << job.overruns << " paused=" << job.paused_ns / 1000000
+                      << "ms run p50=" << job.run.quantile(0.5) << "ns wakeup p50="
+                      << job.wakeup.quantile(0.5) << "ns p99=" << job.wakeup.quantile(0.99)
+                      << "ns" << std::endl;
+        }
+    }
+
+    // 해제하면 더 이상 조회되지 않으며, 마지막 참조가 사라질 때 컨트롤러가 소멸됩니다.
+    threads.erase("fast");
+
+    // 프로그램 종료 시, 레지스트리가 남은 ThreadController를 소멸시킵니다.
     std::cout << "Program terminating..." << std::endl;
     return 0;
 }
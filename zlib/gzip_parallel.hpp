@@ -0,0 +1,177 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+
+#include "crc32.hpp"
+
+// Compresses a buffer into one gzip member on several threads, the way pigz
+// does. The input is cut into blocks that are deflated independently, each
+// primed with the 32 KiB of input before it as its dictionary, so matches
+// can reach back across block boundaries and the ratio stays within a
+// fraction of a percent of single-threaded deflate. Every block but the last
+// ends with a sync flush, which byte-aligns it, so the raw deflate blocks
+// simply concatenate; the CRC-32s of the blocks are joined with
+// crc32_combine(). Any gzip reader can decompress the result.
+class ParallelGzip {
+  public:
+    struct Options {
+        size_t block_size = 128 << 10;  // input bytes per block, at least 32 KiB is sensible
+        int level = Z_DEFAULT_COMPRESSION;
+        size_t threads = 0;  // 0: one per core
+    };
+
+    ParallelGzip() = default;
+    explicit ParallelGzip(const Options &options) : options_(options) {}
+
+    const Options &options() const { return options_; }
+
+    // Replaces `out` with the gzip encoding of [in, in + size).
+    bool compress(const uint8_t *in, size_t size, std::vector<uint8_t> &out) const {
+        size_t block_size = std::clamp<size_t>(options_.block_size, 1, kMaxBlock);
+        size_t count = std::max<size_t>(1, (size + block_size - 1) / block_size);
+        std::vector<Block> blocks(count);
+
+        std::atomic<size_t> next{0};
+        std::atomic<bool> failed{false};
+        auto worker = [&] {
+            Stream stream;
+            if (!stream.init(options_.level)) {
+                failed = true;
+                return;
+            }
+            for (size_t i = next++; i < count && !failed; i = next++) {
+                size_t begin = i * block_size;
+                size_t length = std::min(block_size, size - std::min(size, begin));
+                if (!stream.deflateBlock(in, begin, length, i + 1 == count, blocks[i])) {
+                    failed = true;
+                    return;
+                }
+            }
+        };
+
+        size_t threads = options_.threads != 0 ? options_.threads
+                                               : std::max(1u, std::thread::hardware_concurrency());
+        threads = std::min(threads, count);
+        std::vector<std::thread> pool;
+        for (size_t t = 1; t < threads; ++t) {
+            pool.emplace_back(worker);
+        }
+        worker();
+        for (std::thread &t : pool) {
+            t.join();
+        }
+        if (failed)
+            return false;
+
+        // Stitch: header, the blocks in order, then CRC-32 and ISIZE.
+        size_t total = kHeaderSize + kTrailerSize;
+        for (const Block &b : blocks) {
+            total += b.data.size();
+        }
+        out.resize(total);
+        uint8_t *p = out.data();
+        p = writeHeader(p, options_.level);
+        uLong crc = crc32(0L, Z_NULL, 0);
+        for (const Block &b : blocks) {
+            p = std::copy(b.data.begin(), b.data.end(), p);
+            crc = crc32_combine(crc, b.crc, static_cast<z_off_t>(b.length));
+        }
+        p = put32(p, static_cast<uint32_t>(crc));
+        put32(p, static_cast<uint32_t>(size));  // ISIZE is the size modulo 2^32
+        return true;
+    }
+
+  private:
+    static constexpr size_t kHeaderSize = 10;
+    static constexpr size_t kTrailerSize = 8;
+    static constexpr size_t kDictionary = 32 << 10;
+    static constexpr size_t kMaxBlock = 1 << 30;  // avail_in is 32 bits
+
+    struct Block {
+        std::vector<uint8_t> data;  // raw deflate, byte-aligned at the end
+        uLong crc = 0;
+        size_t length = 0;
+    };
+
+    // One raw deflate stream per thread, reset between blocks.
+    class Stream {
+      public:
+        Stream() = default;
+        Stream(const Stream &) = delete;
+        Stream &operator=(const Stream &) = delete;
+
+        ~Stream() {
+            if (ready_)
+                deflateEnd(&z_);
+        }
+
+        bool init(int level) {
+            if (deflateInit2(&z_, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+                std::cerr << "Error initializing zlib deflate" << std::endl;
+                return false;
+            }
+            ready_ = true;
+            return true;
+        }
+
+        bool deflateBlock(const uint8_t *in, size_t begin, size_t length, bool last, Block &out) {
+            deflateReset(&z_);
+            if (begin > 0) {
+                size_t dict = std::min(begin, kDictionary);
+                deflateSetDictionary(&z_, in + begin - dict, static_cast<uInt>(dict));
+            }
+
+            // Room for the data, plus the empty stored block a sync flush adds.
+            out.data.resize(deflateBound(&z_, length) + 16);
+            z_.next_in = const_cast<Bytef *>(in + begin);
+            z_.avail_in = static_cast<uInt>(length);
+            z_.next_out = out.data.data();
+            z_.avail_out = static_cast<uInt>(out.data.size());
+            int flush = last ? Z_FINISH : Z_SYNC_FLUSH;
+            int ret = deflate(&z_, flush);
+            while (ret == Z_OK && (z_.avail_in > 0 || z_.avail_out == 0)) {
+                // deflateBound() is meant to make this unreachable.
+                size_t used = out.data.size() - z_.avail_out;
+                out.data.resize(out.data.size() * 2);
+                z_.next_out = out.data.data() + used;
+                z_.avail_out = static_cast<uInt>(out.data.size() - used);
+                ret = deflate(&z_, flush);
+            }
+            if (ret != (last ? Z_STREAM_END : Z_OK)) {
+                std::cerr << "Error deflating block at " << begin << ": " << ret << std::endl;
+                return false;
+            }
+            out.data.resize(out.data.size() - z_.avail_out);
+            out.crc = Crc32::update(0, in + begin, length);
+            out.length = length;
+            return true;
+        }
+
+      private:
+        z_stream z_{};
+        bool ready_ = false;
+    };
+
+    static uint8_t *put32(uint8_t *p, uint32_t v) {
+        for (int i = 0; i < 4; ++i) {
+            *p++ = static_cast<uint8_t>(v >> (8 * i));
+        }
+        return p;
+    }
+
+    // RFC 1952: no name, no mtime, OS unix.
+    static uint8_t *writeHeader(uint8_t *p, int level) {
+        const uint8_t xfl = level == 9 ? 2 : level == 1 ? 4 : 0;
+        const uint8_t header[kHeaderSize] = {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, xfl, 3};
+        return std::copy(header, header + kHeaderSize, p);
+    }
+
+    Options options_;
+};
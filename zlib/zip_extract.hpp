@@ -0,0 +1,169 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <fcntl.h>
+#include <iostream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "zip_reader.hpp"
+
+// Extracts every entry of a mapped archive below a directory, spreading
+// entries over worker threads. Each worker owns one Inflater (one z_stream,
+// reset between entries) and reads through its own MappedFile::View of the
+// shared mapping. Entries are handed out largest first so that one big
+// entry at the end does not leave the other threads idle.
+class ParallelExtractor {
+  public:
+    struct Result {
+        bool ok = true;
+        uint64_t entries = 0;
+        uint64_t bytes = 0;  // uncompressed bytes written
+    };
+
+    explicit ParallelExtractor(ZipReader<MappedFile> &zip) : zip_(zip), file_(zip.source()) {}
+
+    Result extractAll(const std::string &out_dir, size_t threads) {
+        const std::vector<ZipEntry> &entries = zip_.entries();
+        Result result;
+
+        // Directories are made up front, on one thread, so workers only ever
+        // create files.
+        std::vector<size_t> files;
+        for (size_t i = 0; i < entries.size(); ++i) {
+            const std::string &name = entries[i].name;
+            if (!safeName(name)) {
+                std::cerr << "Error: refusing to extract " << name << std::endl;
+                result.ok = false;
+                return result;
+            }
+            std::string path = out_dir + "/" + name;
+            size_t slash = path.rfind('/');
+            if (!makeDirs(path.substr(0, slash))) {
+                result.ok = false;
+                return result;
+            }
+            if (name.back() != '/')
+                files.push_back(i);
+        }
+        std::sort(files.begin(), files.end(), [&](size_t a, size_t b) {
+            return entries[a].compressed_size > entries[b].compressed_size;
+        });
+
+        // Pages are brought in per entry with MADV_WILLNEED instead.
+        file_.advise(0, file_.size(), MADV_RANDOM);
+
+        std::atomic<size_t> next{0};
+        std::atomic<bool> failed{false};
+        std::atomic<uint64_t> bytes{0};
+        auto worker = [&] {
+            Inflater inflater(-MAX_WBITS);
+            MappedFile::View view(file_);
+            for (size_t i = next++; i < files.size() && !failed; i = next++) {
+                const ZipEntry &entry = entries[files[i]];
+                if (!extractOne(view, entry, out_dir + "/" + entry.name, inflater)) {
+                    failed = true;
+                    break;
+                }
+                bytes += entry.uncompressed_size;
+            }
+        };
+
+        threads = std::max<size_t>(1, std::min(threads, files.size()));
+        std::vector<std::thread> pool;
+        for (size_t t = 1; t < threads; ++t) {
+            pool.emplace_back(worker);
+        }
+        worker();
+        for (std::thread &t : pool) {
+            t.join();
+        }
+
+        result.ok = !failed;
+        result.entries = files.size();
+        result.bytes = bytes;
+        return result;
+    }
+
+  private:
+    // Room for the local header's name and extra field, which the central
+    // directory does not give the exact length of.
+    static constexpr uint64_t kHeaderSlack = sizeof(LocalFileHeader) + 2 * 65535;
+
+    bool extractOne(MappedFile::View &view, const ZipEntry &entry, const std::string &path,
+                    Inflater &inflater) {
+        uint64_t span = kHeaderSlack + entry.compressed_size;
+        file_.advise(entry.local_header_offset, span, MADV_WILLNEED);
+
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd == -1) {
+            std::cerr << "Error creating file: " << path << std::endl;
+            return false;
+        }
+        // Reserve the whole file at once: fewer extent updates and no
+        // fragmentation from several files growing side by side. Not every
+        // filesystem supports it, and nothing depends on it.
+        if (entry.uncompressed_size > 0)
+            fallocate(fd, 0, 0, static_cast<off_t>(entry.uncompressed_size));
+
+        bool ok = zip_.extract(view, entry, inflater, [&](const uint8_t *data, size_t size) {
+            while (size > 0) {
+                ssize_t n = ::write(fd, data, size);
+                if (n < 0) {
+                    if (errno == EINTR)
+                        continue;
+                    std::cerr << "Error writing file: " << path << std::endl;
+                    return false;
+                }
+                data += n;
+                size -= static_cast<size_t>(n);
+            }
+            return true;
+        });
+        close(fd);
+
+        // Done with this part of the archive.
+        file_.advise(entry.local_header_offset, span, MADV_DONTNEED);
+        return ok;
+    }
+
+    // Relative, and without ".." components: nothing may land outside out_dir.
+    static bool safeName(const std::string &name) {
+        if (name.empty() || name.front() == '/')
+            return false;
+        size_t start = 0;
+        while (start <= name.size()) {
+            size_t end = name.find('/', start);
+            if (end == std::string::npos)
+                end = name.size();
+            if (name.compare(start, end - start, "..") == 0)
+                return false;
+            start = end + 1;
+        }
+        return true;
+    }
+
+    // mkdir -p
+    static bool makeDirs(const std::string &dir) {
+        for (size_t pos = 1; pos <= dir.size(); ++pos) {
+            if (pos != dir.size() && dir[pos] != '/')
+                continue;
+            std::string part = dir.substr(0, pos);
+            if (mkdir(part.c_str(), 0755) == -1 && errno != EEXIST) {
+                std::cerr << "Error creating directory: " << part << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const ZipReader<MappedFile> &zip_;
+    MappedFile &file_;
+};
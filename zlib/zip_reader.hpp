@@ -0,0 +1,377 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <zlib.h>
+
+#include "zip_stream.hpp"
+
+// On-disk records, little-endian and unaligned as in the ZIP specification
+// (APPNOTE.TXT 4.3). They are copied out of the file with memcpy.
+
+struct __attribute__((packed)) LocalFileHeader {
+    uint32_t signature;  // 0x04034b50
+    uint16_t version;
+    uint16_t flags;
+    uint16_t compression;
+    uint16_t mod_time;
+    uint16_t mod_date;
+    uint32_t crc32;
+    uint32_t compressed_size;
+    uint32_t uncompressed_size;
+    uint16_t file_name_length;
+    uint16_t extra_field_length;
+};
+static_assert(sizeof(LocalFileHeader) == 30, "LocalFileHeader must match the file layout");
+
+struct __attribute__((packed)) CentralDirectoryHeader {
+    uint32_t signature;  // 0x02014b50
+    uint16_t version_made_by;
+    uint16_t version;
+    uint16_t flags;
+    uint16_t compression;
+    uint16_t mod_time;
+    uint16_t mod_date;
+    uint32_t crc32;
+    uint32_t compressed_size;
+    uint32_t uncompressed_size;
+    uint16_t file_name_length;
+    uint16_t extra_field_length;
+    uint16_t comment_length;
+    uint16_t disk_number;
+    uint16_t internal_attributes;
+    uint32_t external_attributes;
+    uint32_t local_header_offset;
+};
+static_assert(sizeof(CentralDirectoryHeader) == 46, "CentralDirectoryHeader must match");
+
+struct __attribute__((packed)) EndOfCentralDirectory {
+    uint32_t signature;  // 0x06054b50
+    uint16_t disk_number;
+    uint16_t cd_disk;
+    uint16_t disk_entries;
+    uint16_t total_entries;
+    uint32_t cd_size;
+    uint32_t cd_offset;
+    uint16_t comment_length;
+};
+static_assert(sizeof(EndOfCentralDirectory) == 22, "EndOfCentralDirectory must match");
+
+struct __attribute__((packed)) Zip64EndLocator {
+    uint32_t signature;  // 0x07064b50
+    uint32_t eocd_disk;
+    uint64_t eocd_offset;
+    uint32_t total_disks;
+};
+static_assert(sizeof(Zip64EndLocator) == 20, "Zip64EndLocator must match");
+
+struct __attribute__((packed)) Zip64EndOfCentralDirectory {
+    uint32_t signature;  // 0x06064b50
+    uint64_t record_size;
+    uint16_t version_made_by;
+    uint16_t version;
+    uint32_t disk_number;
+    uint32_t cd_disk;
+    uint64_t disk_entries;
+    uint64_t total_entries;
+    uint64_t cd_size;
+    uint64_t cd_offset;
+};
+static_assert(sizeof(Zip64EndOfCentralDirectory) == 56, "Zip64EndOfCentralDirectory must match");
+
+// One file in the archive, as described by the central directory.
+struct ZipEntry {
+    std::string name;
+    uint16_t compression;  // 0 stored, 8 deflate
+    uint16_t flags;
+    uint32_t crc32;
+    uint64_t compressed_size;
+    uint64_t uncompressed_size;
+    uint64_t local_header_offset;
+};
+
+// Reads a ZIP archive through a Source (MappedFile or PreadFile). open()
+// parses the central directory once and indexes entries by name; after that
+// any entry is found in O(1) and streamed out without touching the others.
+template <typename Source = MappedFile>
+class ZipReader {
+  public:
+    static constexpr uint16_t kStored = 0;
+    static constexpr uint16_t kDeflated = 8;
+
+    bool open(const std::string &filename) {
+        if (!source_.open(filename))
+            return false;
+        if (!readCentralDirectory()) {
+            std::cerr << "Error: " << filename << " is not a valid ZIP archive" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    Source &source() { return source_; }
+    const std::vector<ZipEntry> &entries() const { return entries_; }
+
+    const ZipEntry *find(std::string_view name) const {
+        auto it = index_.find(name);
+        return it == index_.end() ? nullptr : &entries_[it->second];
+    }
+
+    // Streams the entry's contents to sink(const uint8_t *, size_t) and
+    // checks its size and CRC-32. `inflater` must use raw deflate
+    // (window bits -MAX_WBITS); it is reused across calls.
+    template <typename Sink>
+    bool extract(const ZipEntry &entry, Inflater &inflater, Sink &&sink) {
+        return extract(source_, entry, inflater, std::forward<Sink>(sink));
+    }
+
+    // Same, reading through another Source over the same file, such as a
+    // MappedFile::View per thread. Safe to call concurrently with distinct
+    // inflaters and sources.
+    template <typename Src, typename Sink>
+    bool extract(Src &source, const ZipEntry &entry, Inflater &inflater, Sink &&sink) const {
+        uint64_t offset;
+        if (!dataOffset(source, entry, offset))
+            return false;
+        if (entry.flags & 1) {
+            std::cerr << "Error: " << entry.name << " is encrypted" << std::endl;
+            return false;
+        }
+
+        uint32_t crc = 0;
+        uint64_t size = 0;
+        bool ok;
+        if (entry.compression == kDeflated) {
+            // The inflater checksums each chunk as it produces it.
+            ok = inflater.inflate(source, offset, entry.compressed_size, sink);
+            crc = inflater.crc();
+            size = inflater.produced();
+        } else if (entry.compression == kStored) {
+            ok = copy(source, offset, entry.compressed_size, [&](const uint8_t *data, size_t n) {
+                crc = Crc32::update(crc, data, n);
+                size += n;
+                return sink(data, n);
+            });
+        } else {
+            std::cerr << "Error: " << entry.name << " uses unsupported compression method "
+                      << entry.compression << std::endl;
+            return false;
+        }
+        if (!ok)
+            return false;
+
+        if (size != entry.uncompressed_size || crc != entry.crc32) {
+            std::cerr << "Error: " << entry.name << " is corrupt (size " << size << "/"
+                      << entry.uncompressed_size << ", crc " << std::hex << crc << "/"
+                      << entry.crc32 << std::dec << ")" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+  private:
+    static constexpr uint32_t kEndSignature = 0x06054b50;
+    static constexpr uint32_t kZip64LocatorSignature = 0x07064b50;
+    static constexpr uint32_t kZip64EndSignature = 0x06064b50;
+    static constexpr uint32_t kCentralSignature = 0x02014b50;
+    static constexpr uint32_t kLocalSignature = 0x04034b50;
+    static constexpr uint16_t kZip64ExtraId = 0x0001;
+
+    // Copies [offset, offset + size) out of the source.
+    template <typename Src>
+    static bool read(Src &source, uint64_t offset, size_t size, void *out) {
+        auto *dst = static_cast<uint8_t *>(out);
+        while (size > 0) {
+            const uint8_t *data = nullptr;
+            size_t got = source.fetch(offset, size, data);
+            if (got == 0)
+                return false;
+            memcpy(dst, data, got);
+            dst += got;
+            offset += got;
+            size -= got;
+        }
+        return true;
+    }
+
+    bool read(uint64_t offset, size_t size, void *out) { return read(source_, offset, size, out); }
+
+    template <typename Record>
+    bool read(uint64_t offset, Record &record) {
+        return read(source_, offset, sizeof(Record), &record);
+    }
+
+    template <typename Src, typename Sink>
+    static bool copy(Src &source, uint64_t offset, uint64_t size, Sink &&sink) {
+        while (size > 0) {
+            const uint8_t *data = nullptr;
+            size_t got = source.fetch(
+                offset, static_cast<size_t>(std::min<uint64_t>(size, Inflater::kInputChunk)),
+                data);
+            if (got == 0)
+                return false;
+            if (!sink(data, got))
+                return false;
+            offset += got;
+            size -= got;
+        }
+        return true;
+    }
+
+    // The end record sits in the last 22 bytes plus up to 64 KiB of comment.
+    bool findEnd(uint64_t &end_offset, EndOfCentralDirectory &end) {
+        uint64_t file_size = source_.size();
+        if (file_size < sizeof(EndOfCentralDirectory))
+            return false;
+        size_t tail_size = static_cast<size_t>(
+            std::min<uint64_t>(file_size, sizeof(EndOfCentralDirectory) + 0xffff));
+        std::vector<uint8_t> tail(tail_size);
+        if (!read(file_size - tail_size, tail_size, tail.data()))
+            return false;
+
+        for (size_t i = tail_size - sizeof(EndOfCentralDirectory) + 1; i-- > 0;) {
+            uint32_t signature;
+            memcpy(&signature, &tail[i], sizeof(signature));
+            if (signature != kEndSignature)
+                continue;
+            memcpy(&end, &tail[i], sizeof(end));
+            // The comment has to reach exactly to the end of the file.
+            if (i + sizeof(end) + end.comment_length != tail_size)
+                continue;
+            end_offset = file_size - tail_size + i;
+            return true;
+        }
+        return false;
+    }
+
+    bool readCentralDirectory() {
+        uint64_t end_offset;
+        EndOfCentralDirectory end;
+        if (!findEnd(end_offset, end))
+            return false;
+
+        uint64_t count = end.total_entries;
+        uint64_t cd_size = end.cd_size;
+        uint64_t cd_offset = end.cd_offset;
+
+        // Saturated fields mean the real values are in the ZIP64 end record.
+        Zip64EndLocator locator;
+        if (end_offset >= sizeof(locator) && read(end_offset - sizeof(locator), locator) &&
+            locator.signature == kZip64LocatorSignature) {
+            Zip64EndOfCentralDirectory end64;
+            if (!read(locator.eocd_offset, end64) || end64.signature != kZip64EndSignature)
+                return false;
+            count = end64.total_entries;
+            cd_size = end64.cd_size;
+            cd_offset = end64.cd_offset;
+        }
+        // Written so that corrupt 64-bit fields cannot wrap around, and a claimed
+        // count that cannot fit in the directory fails before reserve() throws.
+        if (cd_size > end_offset || cd_offset > end_offset - cd_size)
+            return false;
+        if (count > cd_size / sizeof(CentralDirectoryHeader))
+            return false;
+
+        // One read of the whole directory, then parse it in memory.
+        std::vector<uint8_t> cd(static_cast<size_t>(cd_size));
+        if (!read(cd_offset, cd.size(), cd.data()))
+            return false;
+
+        entries_.clear();
+        entries_.reserve(static_cast<size_t>(count));
+        size_t pos = 0;
+        for (uint64_t i = 0; i < count; ++i) {
+            CentralDirectoryHeader h;
+            if (pos + sizeof(h) > cd.size())
+                return false;
+            memcpy(&h, &cd[pos], sizeof(h));
+            if (h.signature != kCentralSignature)
+                return false;
+            size_t name_at = pos + sizeof(h);
+            size_t extra_at = name_at + h.file_name_length;
+            pos = extra_at + h.extra_field_length + h.comment_length;
+            if (pos > cd.size())
+                return false;
+
+            ZipEntry e;
+            e.name.assign(reinterpret_cast<const char *>(&cd[name_at]), h.file_name_length);
+            e.compression = h.compression;
+            e.flags = h.flags;
+            e.crc32 = h.crc32;
+            e.compressed_size = h.compressed_size;
+            e.uncompressed_size = h.uncompressed_size;
+            e.local_header_offset = h.local_header_offset;
+            if (!applyZip64(h, &cd[extra_at], h.extra_field_length, e))
+                return false;
+            entries_.push_back(std::move(e));
+        }
+
+        // Built last: the keys point into entries_, which no longer moves.
+        index_.clear();
+        index_.reserve(entries_.size());
+        for (size_t i = 0; i < entries_.size(); ++i) {
+            index_.emplace(entries_[i].name, i);
+        }
+        return true;
+    }
+
+    // Fields saturated in the central directory header are stored, in this
+    // order, in the ZIP64 extra field.
+    static bool applyZip64(const CentralDirectoryHeader &h, const uint8_t *extra, size_t size,
+                           ZipEntry &e) {
+        bool need_usize = h.uncompressed_size == 0xffffffff;
+        bool need_csize = h.compressed_size == 0xffffffff;
+        bool need_offset = h.local_header_offset == 0xffffffff;
+        if (!need_usize && !need_csize && !need_offset)
+            return true;
+
+        for (size_t pos = 0; pos + 4 <= size;) {
+            uint16_t id, length;
+            memcpy(&id, extra + pos, 2);
+            memcpy(&length, extra + pos + 2, 2);
+            pos += 4;
+            if (pos + length > size)
+                return false;
+            if (id == kZip64ExtraId) {
+                const uint8_t *field = extra + pos;
+                const uint8_t *field_end = field + length;
+                auto next = [&](uint64_t &value) {
+                    if (field + 8 > field_end)
+                        return false;
+                    memcpy(&value, field, 8);
+                    field += 8;
+                    return true;
+                };
+                return (!need_usize || next(e.uncompressed_size)) &&
+                       (!need_csize || next(e.compressed_size)) &&
+                       (!need_offset || next(e.local_header_offset));
+            }
+            pos += length;
+        }
+        return false;
+    }
+
+    // The local header repeats name and extra field, possibly with a
+    // different extra length, so the data offset has to be read from it.
+    template <typename Src>
+    static bool dataOffset(Src &source, const ZipEntry &entry, uint64_t &offset) {
+        LocalFileHeader h;
+        if (!read(source, entry.local_header_offset, sizeof(h), &h) ||
+            h.signature != kLocalSignature) {
+            std::cerr << "Error: Invalid local file header for " << entry.name << std::endl;
+            return false;
+        }
+        offset = entry.local_header_offset + sizeof(h) + h.file_name_length +
+                 h.extra_field_length;
+        return true;
+    }
+
+    Source source_;
+    std::vector<ZipEntry> entries_;
+    std::unordered_map<std::string_view, size_t> index_;
+};
@@ -0,0 +1,270 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <fcntl.h>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "crc32.hpp"
+
+// Input for Inflater: a Source hands out the bytes at a file offset.
+//   size_t fetch(uint64_t offset, size_t max, const uint8_t *&data)
+// points `data` at up to `max` bytes starting at `offset` and returns how
+// many there are (0 at end of file or on error). The bytes stay valid until
+// the next fetch.
+
+// Read-only mapping of a whole file. Pages that were consumed are dropped
+// from the resident set as reading moves on, so a sequential pass over a
+// multi-GB file keeps only a few MiB resident.
+class MappedFile {
+  public:
+    // How far behind the read position pages are released.
+    static constexpr uint64_t kReleaseLag = 8 << 20;
+
+    MappedFile() = default;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile() {
+        if (data_ != nullptr)
+            munmap(const_cast<uint8_t *>(data_), size_);
+    }
+
+    bool open(const std::string &filename) {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd == -1) {
+            std::cerr << "Error opening file: " << filename << std::endl;
+            return false;
+        }
+
+        struct stat sb;
+        if (fstat(fd, &sb) == -1) {
+            std::cerr << "Error getting file size: " << filename << std::endl;
+            close(fd);
+            return false;
+        }
+        size_ = static_cast<uint64_t>(sb.st_size);
+        if (size_ == 0) {
+            close(fd);
+            return true;
+        }
+
+        void *ptr = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (ptr == MAP_FAILED) {
+            std::cerr << "Error mmap-ing file: " << filename << std::endl;
+            return false;
+        }
+        data_ = static_cast<const uint8_t *>(ptr);
+        madvise(ptr, size_, MADV_SEQUENTIAL);
+        return true;
+    }
+
+    const uint8_t *data() const { return data_; }
+    uint64_t size() const { return size_; }
+
+    // madvise() for the pages covering [offset, offset + length).
+    void advise(uint64_t offset, uint64_t length, int advice) const {
+        if (offset >= size_ || length == 0)
+            return;
+        uint64_t begin = offset & ~uint64_t(pageSize() - 1);
+        uint64_t end = std::min(offset + length, size_);
+        madvise(const_cast<uint8_t *>(data_) + begin, end - begin, advice);
+    }
+
+    // A Source over the same mapping that never releases pages, for threads
+    // reading different parts of the file at once. Use advise() instead.
+    class View {
+      public:
+        explicit View(const MappedFile &file) : file_(file) {}
+
+        uint64_t size() const { return file_.size_; }
+
+        size_t fetch(uint64_t offset, size_t max, const uint8_t *&data) const {
+            if (offset >= file_.size_)
+                return 0;
+            data = file_.data_ + offset;
+            return static_cast<size_t>(std::min<uint64_t>(max, file_.size_ - offset));
+        }
+
+      private:
+        const MappedFile &file_;
+    };
+
+    size_t fetch(uint64_t offset, size_t max, const uint8_t *&data) {
+        if (offset >= size_)
+            return 0;
+        // Let go of what lies well behind the reader.
+        if (offset > released_ + 2 * kReleaseLag) {
+            uint64_t upto = (offset - kReleaseLag) & ~uint64_t(pageSize() - 1);
+            madvise(const_cast<uint8_t *>(data_) + released_, upto - released_, MADV_DONTNEED);
+            released_ = upto;
+        }
+        data = data_ + offset;
+        return static_cast<size_t>(std::min<uint64_t>(max, size_ - offset));
+    }
+
+  private:
+    static size_t pageSize() {
+        static const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        return page;
+    }
+
+    const uint8_t *data_ = nullptr;
+    uint64_t size_ = 0;
+    uint64_t released_ = 0;
+};
+
+// Reads through a fixed window with pread(); memory use is the window,
+// whatever the file size. For files that can't or shouldn't be mapped.
+class PreadFile {
+  public:
+    static constexpr size_t kWindow = 1 << 20;
+
+    PreadFile() = default;
+    PreadFile(const PreadFile &) = delete;
+    PreadFile &operator=(const PreadFile &) = delete;
+
+    ~PreadFile() {
+        if (fd_ != -1)
+            close(fd_);
+    }
+
+    bool open(const std::string &filename) {
+        fd_ = ::open(filename.c_str(), O_RDONLY);
+        if (fd_ == -1) {
+            std::cerr << "Error opening file: " << filename << std::endl;
+            return false;
+        }
+        struct stat sb;
+        if (fstat(fd_, &sb) == -1) {
+            std::cerr << "Error getting file size: " << filename << std::endl;
+            return false;
+        }
+        size_ = static_cast<uint64_t>(sb.st_size);
+        posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+        window_.reset(new uint8_t[kWindow]);
+        return true;
+    }
+
+    uint64_t size() const { return size_; }
+
+    size_t fetch(uint64_t offset, size_t max, const uint8_t *&data) {
+        if (offset >= size_)
+            return 0;
+        size_t want = static_cast<size_t>(std::min<uint64_t>({max, kWindow, size_ - offset}));
+        size_t got = 0;
+        while (got < want) {
+            ssize_t n = pread(fd_, window_.get() + got, want - got, offset + got);
+            if (n <= 0)
+                break;
+            got += static_cast<size_t>(n);
+        }
+        data = window_.get();
+        return got;
+    }
+
+  private:
+    int fd_ = -1;
+    uint64_t size_ = 0;
+    std::unique_ptr<uint8_t[]> window_;
+};
+
+// Streams one compressed range of a Source through zlib into a sink, in
+// kChunk-sized pieces. The z_stream and the output buffer are allocated
+// once and reused for every call, so memory stays at about 300 KiB no
+// matter how large the input or output is. The CRC-32 of the output is
+// taken chunk by chunk right after inflate() wrote it, while it is still in
+// cache.
+class Inflater {
+  public:
+    static constexpr size_t kInputChunk = 1 << 20;
+    static constexpr size_t kChunk = 256 << 10;
+
+    // window_bits as for inflateInit2(): negative for raw deflate,
+    // +16 for gzip.
+    explicit Inflater(int window_bits) : window_bits_(window_bits), out_(new uint8_t[kChunk]) {}
+
+    Inflater(const Inflater &) = delete;
+    Inflater &operator=(const Inflater &) = delete;
+
+    ~Inflater() {
+        if (ready_)
+            inflateEnd(&strm_);
+    }
+
+    // Inflates `size` bytes at `offset` and hands the output to
+    // sink(const uint8_t *data, size_t size), which returns false to stop.
+    // Returns true once the compressed stream ended cleanly.
+    template <typename Source, typename Sink>
+    bool inflate(Source &source, uint64_t offset, uint64_t size, Sink &&sink) {
+        if (!reset())
+            return false;
+
+        produced_ = 0;
+        crc_ = 0;
+        uint64_t end = offset + size;
+        int ret = Z_OK;
+        while (ret != Z_STREAM_END) {
+            if (strm_.avail_in == 0) {
+                const uint8_t *data = nullptr;
+                size_t max = static_cast<size_t>(std::min<uint64_t>(kInputChunk, end - offset));
+                size_t got = max > 0 ? source.fetch(offset, max, data) : 0;
+                if (got == 0) {
+                    std::cerr << "Error inflating data: input ends early" << std::endl;
+                    return false;
+                }
+                strm_.next_in = const_cast<Bytef *>(data);
+                strm_.avail_in = static_cast<uInt>(got);
+                offset += got;
+            }
+
+            strm_.next_out = out_.get();
+            strm_.avail_out = static_cast<uInt>(kChunk);
+            ret = ::inflate(&strm_, Z_NO_FLUSH);
+            if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+                std::cerr << "Error inflating data: " << ret
+                          << (strm_.msg != nullptr ? std::string(" ") + strm_.msg : "")
+                          << std::endl;
+                return false;
+            }
+
+            size_t have = kChunk - strm_.avail_out;
+            produced_ += have;
+            crc_ = Crc32::update(crc_, out_.get(), have);
+            if (have > 0 && !sink(out_.get(), have))
+                return false;
+        }
+        return true;
+    }
+
+    // Bytes produced by the last inflate().
+    uint64_t produced() const { return produced_; }
+    // CRC-32 of what the last inflate() produced.
+    uint32_t crc() const { return crc_; }
+
+  private:
+    bool reset() {
+        int ret = ready_ ? inflateReset(&strm_) : inflateInit2(&strm_, window_bits_);
+        if (ret != Z_OK) {
+            std::cerr << "Error initializing zlib inflate" << std::endl;
+            return false;
+        }
+        ready_ = true;
+        strm_.avail_in = 0;
+        return true;
+    }
+
+    int window_bits_;
+    z_stream strm_{};
+    bool ready_ = false;
+    std::unique_ptr<uint8_t[]> out_;
+    uint64_t produced_ = 0;
+    uint32_t crc_ = 0;
+};
@@ -1,146 +1,411 @@
+#include <chrono>
 #include <cstdint>
 #include <fcntl.h>
+#include <ftw.h>
 #include <fstream>
 #include <iostream>
 #include <stdio.h>
 #include <string.h>
 #include <string>
 #include <sys/mman.h>
+#include <sys/resource.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <thread>
 #include <unistd.h>
 #include <vector>
 #include <zlib.h>
 
-struct LocalFileHeader {
-    uint32_t signature;
-    uint16_t version;
-    uint16_t flags;
-    uint16_t compression;
-    uint16_t mod_time;
-    uint16_t mod_date;
-    uint32_t crc32;
-    uint32_t compressed_size;
-    uint32_t uncompressed_size;
-    uint16_t file_name_length;
-    uint16_t extra_field_length;
-};
+#include "gzip_parallel.hpp"
+#include "zip_extract.hpp"
+#include "zip_reader.hpp"
 
-bool readFileToMemory(const std::string &filename, std::vector<uint8_t> &data) {
-    int fd = open(filename.c_str(), O_RDONLY);
-    if (fd == -1) {
-        std::cerr << "Error opening file: " << filename << std::endl;
-        return false;
-    }
+// Peak resident memory of this process, in KiB.
+static long peakRssKb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
 
-    struct stat sb;
-    if (fstat(fd, &sb) == -1) {
-        std::cerr << "Error getting file size: " << filename << std::endl;
-        close(fd);
-        return false;
-    }
+// Lists the archive, or extracts the named entries. Extraction streams each
+// entry through the sink in 256 KiB chunks; here it only counts bytes, write
+// them to a file or socket instead to keep the data.
+template <typename Source>
+int run(const std::string &filename, const std::vector<std::string> &names) {
+    ZipReader<Source> zip;
+    if (!zip.open(filename))
+        return 1;
+    std::cout << "entries              : " << zip.entries().size() << std::endl;
 
-    void *ptr = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
-    if (ptr == MAP_FAILED) {
-        std::cerr << "Error mmap-ing file: " << filename << std::endl;
-        close(fd);
-        return false;
+    if (names.empty()) {
+        for (const ZipEntry &entry : zip.entries()) {
+            std::cout << entry.uncompressed_size << "\t" << entry.compressed_size << "\t"
+                      << entry.name << std::endl;
+        }
+        return 0;
     }
 
-    data = std::vector<uint8_t>(static_cast<uint8_t *>(ptr),
-                                static_cast<uint8_t *>(ptr) + sb.st_size);
+    Inflater inflater(-MAX_WBITS);
+    for (const std::string &name : names) {
+        const ZipEntry *entry = zip.find(name);
+        if (entry == nullptr) {
+            std::cerr << "Error: no entry named " << name << std::endl;
+            return 1;
+        }
 
-    if (munmap(ptr, sb.st_size) == -1) {
-        std::cerr << "Error unmapping file: " << filename << std::endl;
-        close(fd);
-        return false;
+        uint64_t decompressed = 0;
+        if (!zip.extract(*entry, inflater, [&](const uint8_t *, size_t size) {
+                decompressed += size;
+                return true;
+            })) {
+            return 1;
+        }
+        std::cout << name << " : " << decompressed << " bytes, crc " << std::hex
+                  << entry->crc32 << std::dec << " ok" << std::endl;
     }
 
-    close(fd);
-    return true;
+    std::cout << "peak rss (KiB)       : " << peakRssKb() << std::endl;
+    return 0;
 }
 
-bool decompressMemory(const std::vector<uint8_t> &compressedData,
-                      std::vector<uint8_t> &decompressedData) {
-
-    LocalFileHeader header;
-    memcpy(&header, compressedData.data(), sizeof(LocalFileHeader));
-
-    std::cout << "signature            : " << std::hex << header.signature
-              << std::endl;
-    std::cout << "version              : " << header.version << std::endl;
-    std::cout << "flags                : " << header.flags << std::endl;
-    std::cout << "compression          : " << header.compression << std::endl;
-    std::cout << "mod_time             : " << header.mod_time << std::endl;
-    std::cout << "mod_date             : " << header.mod_date << std::endl;
-    std::cout << "crc32                : " << std::hex << header.crc32
-              << std::endl;
-    std::cout << "compressed_size      : " << header.compressed_size
-              << std::endl;
-    std::cout << "uncompressed_size    : " << header.uncompressed_size
-              << std::endl;
-    std::cout << "file_name_length     : " << header.file_name_length
-              << std::endl;
-    std::cout << "extra_field_length   : " << header.extra_field_length
-              << std::endl;
-
-    if (header.signature != 0x04034b50) {
-        std::cerr << "Error: Invalid local file header signature" << std::endl;
-        return false;
+// Extracts the whole archive below out_dir on `threads` threads.
+static int extractAll(const std::string &filename, const std::string &out_dir, size_t threads) {
+    ZipReader<MappedFile> zip;
+    if (!zip.open(filename))
+        return 1;
+    auto start = std::chrono::steady_clock::now();
+    ParallelExtractor::Result result = ParallelExtractor(zip).extractAll(out_dir, threads);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (!result.ok)
+        return 1;
+    std::cout << result.entries << " files, " << result.bytes << " bytes in " << elapsed.count()
+              << " s" << std::endl;
+    return 0;
+}
+
+// Text-like data from a small vocabulary, so it deflates about 3:1 like
+// typical archive contents rather than not at all.
+static void syntheticData(uint64_t seed, size_t size, std::string &out) {
+    static const char *const words[] = {"alpha ",  "beta ",    "gamma ",   "delta ",
+                                        "archive ", "entry ",  "inflate ", "stream ",
+                                        "thread ", "central ", "extract ", "mapping ",
+                                        "\n",      "0123 ",    "4567 ",    "89ab "};
+    out.clear();
+    uint64_t x = seed * 0x9e3779b97f4a7c15ULL + 1;
+    while (out.size() < size) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        out += words[x & 15];
+        if ((x >> 8 & 7) == 0)
+            out += std::to_string(x >> 40);
     }
+    out.resize(size);
+}
 
-    z_stream strm;
-    strm.zalloc = Z_NULL;
-    strm.zfree = Z_NULL;
-    strm.opaque = Z_NULL;
-    strm.avail_in = compressedData.size() - sizeof(LocalFileHeader);
-    strm.next_in =
-        const_cast<uint8_t *>(compressedData.data() + sizeof(LocalFileHeader));
+// Writes a deflated archive of `count` entries of varied sizes spread over a
+// few directories. Sizes stay below 4 GiB, so no ZIP64 records are needed.
+static bool writeSyntheticArchive(const std::string &filename, size_t count, size_t entry_size,
+                                  uint64_t &total) {
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    std::vector<CentralDirectoryHeader> central;
+    std::vector<std::string> names;
+    std::string data, packed;
+    uint64_t offset = 0;
+    total = 0;
 
-    if (inflateInit2(&strm, MAX_WBITS + 16) != Z_OK) {
-        std::cerr << "Error initializing zlib inflate" << std::endl;
+    z_stream z{};
+    if (deflateInit2(&z, 1, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
         return false;
-    }
-
-    std::vector<uint8_t> buffer(1024);
-    do {
-        strm.avail_out = buffer.size();
-        strm.next_out = buffer.data();
-        int ret = inflate(&strm, Z_NO_FLUSH);
-        if (ret == Z_STREAM_ERROR) {
-            std::cerr << "Error inflating data: " << ret << std::endl;
-            inflateEnd(&strm);
+    for (size_t i = 0; i < count; ++i) {
+        // From a quarter to twice entry_size.
+        size_t size = entry_size / 4 + (entry_size * 7 / 4) * ((i * 37) % count) / count;
+        syntheticData(i, size, data);
+        deflateReset(&z);
+        packed.resize(deflateBound(&z, size));
+        z.next_in = reinterpret_cast<Bytef *>(data.data());
+        z.avail_in = static_cast<uInt>(size);
+        z.next_out = reinterpret_cast<Bytef *>(packed.data());
+        z.avail_out = static_cast<uInt>(packed.size());
+        if (deflate(&z, Z_FINISH) != Z_STREAM_END) {
+            deflateEnd(&z);
             return false;
-        } else {
-            std::cerr << "!! Error inflating data: " << ret << std::endl;
         }
-        decompressedData.insert(decompressedData.end(), buffer.data(),
-                                buffer.data() + buffer.size() - strm.avail_out);
-    } while (strm.avail_out == 0);
+        packed.resize(z.total_out);
+
+        std::string name = "dir" + std::to_string(i % 4) + "/file" + std::to_string(i) + ".txt";
+        LocalFileHeader local{};
+        local.signature = 0x04034b50;
+        local.version = 20;
+        local.compression = 8;
+        local.crc32 = Crc32::update(0, reinterpret_cast<const uint8_t *>(data.data()), size);
+        local.compressed_size = static_cast<uint32_t>(packed.size());
+        local.uncompressed_size = static_cast<uint32_t>(size);
+        local.file_name_length = static_cast<uint16_t>(name.size());
+        out.write(reinterpret_cast<const char *>(&local), sizeof(local));
+        out.write(name.data(), name.size());
+        out.write(packed.data(), packed.size());
+
+        CentralDirectoryHeader cd{};
+        cd.signature = 0x02014b50;
+        cd.version_made_by = 20;
+        cd.version = 20;
+        cd.compression = 8;
+        cd.crc32 = local.crc32;
+        cd.compressed_size = local.compressed_size;
+        cd.uncompressed_size = local.uncompressed_size;
+        cd.file_name_length = local.file_name_length;
+        cd.local_header_offset = static_cast<uint32_t>(offset);
+        central.push_back(cd);
+        names.push_back(name);
+        offset += sizeof(local) + name.size() + packed.size();
+        total += size;
+    }
+    deflateEnd(&z);
 
-    inflateEnd(&strm);
-    return true;
+    EndOfCentralDirectory end{};
+    end.signature = 0x06054b50;
+    end.disk_entries = end.total_entries = static_cast<uint16_t>(count);
+    end.cd_offset = static_cast<uint32_t>(offset);
+    for (size_t i = 0; i < count; ++i) {
+        out.write(reinterpret_cast<const char *>(&central[i]), sizeof(central[i]));
+        out.write(names[i].data(), names[i].size());
+        end.cd_size += static_cast<uint32_t>(sizeof(central[i]) + names[i].size());
+    }
+    out.write(reinterpret_cast<const char *>(&end), sizeof(end));
+    return static_cast<bool>(out);
 }
 
-int main() {
-    std::string filename = "slim.zip";
-    std::vector<uint8_t> compressedData;
+static void removeTree(const std::string &dir) {
+    nftw(
+        dir.c_str(),
+        [](const char *path, const struct stat *, int, struct FTW *) { return remove(path); }, 16,
+        FTW_DEPTH | FTW_PHYS);
+}
 
-    if (!readFileToMemory(filename, compressedData)) {
+// Extraction throughput at 1..max_threads threads on a generated archive of
+// 64 entries, 4 MiB on average.
+static int benchExtract(size_t max_threads) {
+    char tmpl[] = "/tmp/zip_bench_XXXXXX";
+    if (mkdtemp(tmpl) == nullptr) {
+        std::cerr << "Error creating a temporary directory" << std::endl;
+        return 1;
+    }
+    std::string dir = tmpl;
+    std::string archive = dir + "/synthetic.zip";
+    uint64_t total = 0;
+    if (!writeSyntheticArchive(archive, 64, 4 << 20, total)) {
+        std::cerr << "Error writing " << archive << std::endl;
+        removeTree(dir);
         return 1;
     }
 
-    std::cout << compressedData.size() << std::endl;
+    int status = 0;
+    std::cout << "cores: " << std::thread::hardware_concurrency() << ", archive: " << (total >> 20)
+              << " MiB uncompressed" << std::endl;
+    std::cout << "threads  MB/s" << std::endl;
+    for (size_t threads = 1; threads <= max_threads && status == 0; ++threads) {
+        ZipReader<MappedFile> zip;
+        if (!zip.open(archive)) {
+            status = 1;
+            break;
+        }
+        std::string out_dir = dir + "/out" + std::to_string(threads);
+        auto start = std::chrono::steady_clock::now();
+        ParallelExtractor::Result result = ParallelExtractor(zip).extractAll(out_dir, threads);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (!result.ok || result.bytes != total) {
+            std::cerr << "extraction failed at " << threads << " threads" << std::endl;
+            status = 1;
+        }
+        printf("%-7zu  %.0f\n", threads, static_cast<double>(result.bytes) / 1e6 / elapsed.count());
+        removeTree(out_dir);
+    }
+    removeTree(dir);
+    return status;
+}
 
-    std::vector<uint8_t> decompressedData;
-    if (!decompressMemory(compressedData, decompressedData)) {
+// Source over a buffer in memory.
+struct MemorySource {
+    const uint8_t *data;
+    size_t size;
+
+    size_t fetch(uint64_t offset, size_t max, const uint8_t *&out) const {
+        if (offset >= size)
+            return 0;
+        out = data + offset;
+        return static_cast<size_t>(std::min<uint64_t>(max, size - offset));
+    }
+};
+
+// True if `gz` is a gzip stream that inflates back to `expected`.
+static bool roundTrips(const std::vector<uint8_t> &gz, const std::string &expected) {
+    MemorySource source{gz.data(), gz.size()};
+    Inflater inflater(MAX_WBITS + 16);
+    size_t pos = 0;
+    bool ok = inflater.inflate(source, 0, gz.size(), [&](const uint8_t *data, size_t size) {
+        if (pos + size > expected.size() || memcmp(expected.data() + pos, data, size) != 0)
+            return false;
+        pos += size;
+        return true;
+    });
+    return ok && pos == expected.size();
+}
+
+// ParallelGzip against one deflate() call, both at `level`, on 128 MiB of
+// generated text. Every output is inflated again and compared.
+static int benchGzip(size_t max_threads, int level, size_t block_size) {
+    std::string input;
+    syntheticData(7, 128 << 20, input);
+    const auto *in = reinterpret_cast<const uint8_t *>(input.data());
+    auto mbps = [&](std::chrono::duration<double> elapsed) {
+        return static_cast<double>(input.size()) / 1e6 / elapsed.count();
+    };
+
+    // Edge cases first: empty, shorter than a block, exactly one block.
+    for (size_t size : {size_t(0), size_t(1000), block_size, block_size + 1}) {
+        std::vector<uint8_t> gz;
+        ParallelGzip small({block_size, level, 2});
+        if (!small.compress(in, size, gz) || !roundTrips(gz, input.substr(0, size))) {
+            std::cerr << "round trip failed for " << size << " bytes" << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<uint8_t> single;
+    auto start = std::chrono::steady_clock::now();
+    {
+        z_stream z{};
+        if (deflateInit2(&z, level, Z_DEFLATED, MAX_WBITS + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+            return 1;
+        single.resize(deflateBound(&z, input.size()));
+        z.next_in = const_cast<Bytef *>(in);
+        z.avail_in = static_cast<uInt>(input.size());
+        z.next_out = single.data();
+        z.avail_out = static_cast<uInt>(single.size());
+        int ret = deflate(&z, Z_FINISH);
+        single.resize(z.total_out);
+        deflateEnd(&z);
+        if (ret != Z_STREAM_END)
+            return 1;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (!roundTrips(single, input))
         return 1;
+
+    std::cout << "cores: " << std::thread::hardware_concurrency() << ", level " << level
+              << ", block " << (block_size >> 10) << " KiB, input " << (input.size() >> 20)
+              << " MiB" << std::endl;
+    std::cout << "threads  MB/s   ratio" << std::endl;
+    printf("deflate  %-5.0f  %.4f\n", mbps(elapsed),
+           static_cast<double>(single.size()) / static_cast<double>(input.size()));
+
+    for (size_t threads = 1; threads <= max_threads; ++threads) {
+        ParallelGzip gzip({block_size, level, threads});
+        std::vector<uint8_t> gz;
+        start = std::chrono::steady_clock::now();
+        if (!gzip.compress(in, input.size(), gz))
+            return 1;
+        elapsed = std::chrono::steady_clock::now() - start;
+        if (!roundTrips(gz, input)) {
+            std::cerr << "output at " << threads << " threads does not inflate back" << std::endl;
+            return 1;
+        }
+        printf("%-7zu  %-5.0f  %.4f\n", threads, mbps(elapsed),
+               static_cast<double>(gz.size()) / static_cast<double>(input.size()));
     }
+    return 0;
+}
+
+// Checks every CRC-32 implementation against zlib's on random data at all
+// lengths up to 1 KiB from every alignment, chained and whole, then reports
+// throughput on 64 MiB.
+static int benchCrc() {
+    std::string data;
+    syntheticData(3, 64 << 20, data);
+    const auto *bytes = reinterpret_cast<const uint8_t *>(data.data());
 
-    std::cout << decompressedData.size() << std::endl;
+    std::vector<std::pair<const char *, Crc32::Function>> impls = {
+        {"slicing-by-8", Crc32::slicing8}};
+#if defined(__x86_64__)
+    if (Crc32::hasPclmul())
+        impls.emplace_back("pclmul", Crc32::pclmul);
+#endif
 
-    // 이제 decompressedData 벡터에 압축 해제된 데이터가 들어있습니다.
-    // 필요한 작업을 수행하세요.
+    uint32_t seed = 0x12345678;
+    for (auto &[name, fn] : impls) {
+        for (size_t align = 0; align < 16; ++align) {
+            for (size_t len = 0; len <= 1024; ++len) {
+                const uint8_t *p = bytes + 4096 * align + align;
+                seed = seed * 1103515245 + 12345;
+                uint32_t want = static_cast<uint32_t>(crc32_z(seed, p, len));
+                size_t split = len / 3;
+                uint32_t whole = fn(seed, p, len);
+                uint32_t chained = fn(fn(seed, p, split), p + split, len - split);
+                if (whole != want || chained != want) {
+                    std::cerr << name << " disagrees with zlib at length " << len
+                              << ", alignment " << align << std::endl;
+                    return 1;
+                }
+            }
+        }
+        if (fn(0, bytes, data.size()) != crc32_z(0, bytes, data.size())) {
+            std::cerr << name << " disagrees with zlib on 64 MiB" << std::endl;
+            return 1;
+        }
+    }
 
+    impls.emplace(impls.begin(), "zlib", [](uint32_t crc, const uint8_t *p, size_t n) {
+        return static_cast<uint32_t>(crc32_z(crc, p, n));
+    });
+    std::cout << "selected: " << Crc32::implementation() << std::endl;
+    std::cout << "implementation  GB/s" << std::endl;
+    for (auto &[name, fn] : impls) {
+        uint32_t crc = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int round = 0; round < 8; ++round) {
+            crc = fn(crc, bytes, data.size());
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        printf("%-14s  %.2f  (%08x)\n", name, 8.0 * data.size() / 1e9 / elapsed.count(), crc);
+    }
     return 0;
-}
\ No newline at end of file
+}
+
+int main(int argc, char *argv[]) {
+    // ./main [file.zip] [--pread] [entry names...]
+    // ./main file.zip --extract-all out_dir [threads]
+    // ./main --bench-extract [max threads]
+    // ./main --bench-gzip [max threads] [level] [block KiB]
+    // ./main --bench-crc
+    if (argc > 1 && strcmp(argv[1], "--bench-crc") == 0)
+        return benchCrc();
+    if (argc > 1 && strcmp(argv[1], "--bench-gzip") == 0) {
+        size_t threads = argc > 2 ? std::stoul(argv[2])
+                                  : std::max(4u, std::thread::hardware_concurrency());
+        int level = argc > 3 ? std::stoi(argv[3]) : 6;
+        size_t block = argc > 4 ? std::stoul(argv[4]) << 10 : ParallelGzip::Options().block_size;
+        return benchGzip(threads, level, block);
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-extract") == 0) {
+        size_t threads = argc > 2 ? std::stoul(argv[2])
+                                  : std::max(4u, std::thread::hardware_concurrency());
+        return benchExtract(threads);
+    }
+    if (argc > 3 && strcmp(argv[2], "--extract-all") == 0) {
+        size_t threads = argc > 4 ? std::stoul(argv[4]) : std::thread::hardware_concurrency();
+        return extractAll(argv[1], argv[3], threads);
+    }
+
+    std::string filename = argc > 1 ? argv[1] : "slim.zip";
+    bool use_pread = false;
+    std::vector<std::string> names;
+    for (int i = 2; i < argc; ++i) {
+        if (strcmp(argv[i], "--pread") == 0)
+            use_pread = true;
+        else
+            names.push_back(argv[i]);
+    }
+
+    return use_pread ? run<PreadFile>(filename, names) : run<MappedFile>(filename, names);
+}